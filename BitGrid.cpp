@@ -0,0 +1,168 @@
+#include "bitgrid.h"
+
+#include <algorithm>
+
+size_t BitGrid::popcount(uint64_t word){
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    size_t n = 0;
+    for(; word; word &= word - 1)
+        n++;
+    return n;
+#endif
+}
+
+static size_t lowestBit(uint64_t word){
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    size_t n = 0;
+    while(!((word >> n) & 1))
+        n++;
+    return n;
+#endif
+}
+
+BitGrid::BitGrid(size_t _rows, size_t _cols):
+rows(_rows),
+cols(_cols),
+words((_cols + 63) / 64),
+bits(_rows * ((_cols + 63) / 64), 0)
+{}
+
+void BitGrid::clear(){
+    std::fill(bits.begin(), bits.end(), 0);
+}
+
+size_t BitGrid::count() const{
+    size_t n = 0;
+    for(uint64_t word : bits)
+        n += popcount(word);
+    return n;
+}
+
+BitGrid BitGrid::passable(const CellGrid& map, TerrainType terrain){
+    BitGrid grid(map.size(), map.empty() ? 0 : map[0].size());
+    for(size_t i = 0; i < grid.rows; i++)
+        for(size_t j = 0; j < grid.cols; j++)
+            if(terrain == TerrainType::AIR || map[i][j] != Cell::WALL)
+                grid.set({i,j});
+    return grid;
+}
+
+BitGrid BitGrid::cellsOf(const CellGrid& map, Cell first, Cell second){
+    BitGrid grid(map.size(), map.empty() ? 0 : map[0].size());
+    for(size_t i = 0; i < grid.rows; i++)
+        for(size_t j = 0; j < grid.cols; j++)
+            if(map[i][j] == first || map[i][j] == second)
+                grid.set({i,j});
+    return grid;
+}
+
+void floodFill(const BitGrid& passable, std::pair<size_t,size_t> source, BitGrid& visited,
+               const std::function<bool(size_t, const BitGrid&, size_t, size_t)>& onLayer){
+    BitGrid sources(passable.getRows(), passable.getCols());
+    sources.set(source);
+    floodFill(passable, sources, visited, onLayer);
+}
+
+Flood::Flood(const BitGrid& _passable, const BitGrid& sources):
+passable(&_passable),
+visited(sources),
+frontier(sources),
+next(sources.getRows(), sources.getCols()),
+empty(sources.getWords(), 0)
+{
+    scratch.resize(visited.getBytes() + frontier.getBytes() + next.getBytes() + bytesOf(empty));
+
+    // rows [low, high] hold the whole frontier, everything outside it reads as empty
+    low = frontier.getRows();
+    for(size_t r = 0; r < frontier.getRows(); r++)
+        for(size_t w = 0; w < frontier.getWords(); w++)
+            if(uint64_t word = frontier.row(r)[w]){
+                low = std::min(low, r);
+                high = r;
+                size += BitGrid::popcount(word);
+            }
+}
+
+bool Flood::grow(){
+    const size_t rows = frontier.getRows();
+    const size_t words = frontier.getWords();
+    if(low == rows)
+        return false;
+
+    size_t from = low > 0 ? low - 1 : 0;
+    size_t to = std::min(high + 1, rows - 1);
+    size_t newLow = rows, newHigh = 0, newSize = 0;
+
+    for(size_t r = from; r <= to; r++){
+        const uint64_t* up = (r > low && r - 1 <= high) ? frontier.row(r - 1) : empty.data();
+        const uint64_t* mid = (r >= low && r <= high) ? frontier.row(r) : empty.data();
+        const uint64_t* down = (r + 1 >= low && r + 1 <= high) ? frontier.row(r + 1) : empty.data();
+        const uint64_t* open = passable->row(r);
+        uint64_t* seen = visited.row(r);
+        uint64_t* out = next.row(r);
+
+        bool any = false;
+        for(size_t w = 0; w < words; w++){
+            // west and east neighbours, carrying the edge bits across word boundaries
+            uint64_t east = (mid[w] << 1) | (w > 0 ? mid[w - 1] >> 63 : 0);
+            uint64_t west = (mid[w] >> 1) | (w + 1 < words ? mid[w + 1] << 63 : 0);
+            uint64_t grown = (east | west | up[w] | down[w]) & open[w] & ~seen[w];
+            out[w] = grown;
+            seen[w] |= grown;
+            if(grown){
+                any = true;
+                newSize += BitGrid::popcount(grown);
+            }
+        }
+        if(any){
+            newLow = std::min(newLow, r);
+            newHigh = r;
+        }
+    }
+
+    if(newLow == rows){
+        low = rows;
+        return false;
+    }
+
+    // rows outside the new band may still hold older layers, they are never read
+    std::swap(frontier, next);
+    low = newLow;
+    high = newHigh;
+    size = newSize;
+    depth++;
+    return true;
+}
+
+void floodFill(const BitGrid& passable, const BitGrid& sources, BitGrid& visited,
+               const std::function<bool(size_t, const BitGrid&, size_t, size_t)>& onLayer){
+    Flood flood(passable, sources);
+    if(flood.getLow() <= flood.getHigh())
+        while(onLayer(flood.getDepth(), flood.getFrontier(), flood.getLow(), flood.getHigh()) && flood.grow());
+    visited = flood.getVisited();
+}
+
+std::vector<int> distanceField(const BitGrid& passable, std::pair<size_t,size_t> source){
+    BitGrid sources(passable.getRows(), passable.getCols());
+    sources.set(source);
+    return distanceField(passable, sources);
+}
+
+std::vector<int> distanceField(const BitGrid& passable, const BitGrid& sources){
+    const size_t cols = passable.getCols();
+    std::vector<int> field(passable.getRows() * cols, -1);
+    BitGrid visited;
+
+    floodFill(passable, sources, visited, [&](size_t step, const BitGrid& layer, size_t low, size_t high){
+        for(size_t r = low; r <= high; r++)
+            for(size_t w = 0; w < layer.getWords(); w++)
+                for(uint64_t word = layer.row(r)[w]; word; word &= word - 1)
+                    field[r * cols + w * 64 + lowestBit(word)] = static_cast<int>(step);
+        return true;
+    });
+    return field;
+}
@@ -0,0 +1,242 @@
+#include <vector>
+#include <climits>
+#include <cstdlib>
+
+#include "types.h"
+#include "agents/agents.h"
+#include "charginggraph.h"
+#include "bitgrid.h"
+#include "pathfinding.h"
+
+// N, S, W, E; NO_HOP marks chargers and cells that cannot reach one
+static const int hopRow[] = {-1,1,0,0};
+static const int hopCol[] = {0,0,-1,1};
+constexpr uint8_t NO_HOP = 255;
+
+static int manhattan(std::pair<size_t,size_t> a, std::pair<size_t,size_t> b){
+    return std::abs((int)a.first - (int)b.first) + std::abs((int)a.second - (int)b.second);
+}
+
+void ChargingGraph::build(const CellGrid& map){
+    rows = map.size();
+    cols = rows ? map[0].size() : 0;
+    nodes.clear();
+    nodeIndex.clear();
+    chargerFields.clear();
+    groundLegs.clear();
+    memory.resize(0);
+
+    // base goes first so node 0 is always the base
+    for(int pass = 0; pass < 3; pass++)
+        for(size_t i = 0; i < rows; i++)
+            for(size_t j = 0; j < cols; j++){
+                Cell cell = map[i][j];
+                if((pass == 0 && cell == Cell::BASE) || (pass == 1 && cell == Cell::STATION) || (pass == 2 && cell == Cell::CLIENT)){
+                    nodeIndex[i * cols + j] = nodes.size();
+                    nodes.push_back({i,j});
+                }
+            }
+
+    chargersN = 0;
+    while(chargersN < nodes.size() && map[nodes[chargersN].first][nodes[chargersN].second] != Cell::CLIENT)
+        chargersN++;
+
+    const size_t nodesN = nodes.size();
+    groundLegs.assign(nodesN * nodesN, -1);
+
+    ground = BitGrid::passable(map, TerrainType::GROUND);
+    // the nearest charger tables below are needed whatever the budget, only the fields are optional
+    size_t required = bytesOf(groundLegs) + ground.getBytes() + 2 * rows * cols * (sizeof(int) + sizeof(uint8_t));
+    memory.resize(required);
+
+    for(size_t u = 0; u < nodesN; u++){
+        std::vector<int> field = distanceField(ground, nodes[u]);
+        for(size_t v = 0; v < nodesN; v++)
+            groundLegs[u * nodesN + v] = field[nodes[v].first * cols + nodes[v].second];
+        if(u >= chargersN)
+            continue;
+        if(MemoryLedger::fits(MemorySubsystem::CACHES, bytesOf(field))){
+            memory.resize(memory.getBytes() + bytesOf(field));
+            chargerFields.push_back(std::move(field));
+        }
+        else
+            chargerFields.emplace_back();
+    }
+
+    // multi-source distance transform from every charger, then each cell points at a neighbour one step closer
+    BitGrid chargers = BitGrid::cellsOf(map, Cell::BASE, Cell::STATION);
+    for(TerrainType terrain : {TerrainType::GROUND, TerrainType::AIR}){
+        int t = static_cast<int>(terrain);
+        nearestDistance[t] = distanceField(BitGrid::passable(map, terrain), chargers);
+        nearestHop[t].assign(rows * cols, NO_HOP);
+
+        for(size_t i = 0; i < rows; i++)
+            for(size_t j = 0; j < cols; j++){
+                int dist = nearestDistance[t][i * cols + j];
+                if(dist <= 0)
+                    continue;
+                for(uint8_t h = 0; h < 4; h++){
+                    size_t ni = i + hopRow[h], nj = j + hopCol[h];
+                    if(ni < rows && nj < cols && nearestDistance[t][ni * cols + nj] == dist - 1){
+                        nearestHop[t][i * cols + j] = h;
+                        break;
+                    }
+                }
+            }
+    }
+}
+
+int ChargingGraph::distanceToCharger(std::pair<size_t,size_t> cell, TerrainType terrain) const{
+    return nearestDistance[static_cast<int>(terrain)][cell.first * cols + cell.second];
+}
+
+int ChargingGraph::chargersWithin(std::pair<size_t,size_t> cell, int steps, TerrainType terrain) const{
+    int count = 0;
+    for(size_t i = 0; i < chargersN; i++){
+        int d = chargerSteps(i, cell, terrain);
+        if(d > 0 && d <= steps)
+            count++;
+    }
+    return count;
+}
+
+std::vector<std::pair<size_t,size_t>> ChargingGraph::pathToCharger(std::pair<size_t,size_t> cell, TerrainType terrain) const{
+    const std::vector<uint8_t>& hops = nearestHop[static_cast<int>(terrain)];
+    std::vector<std::pair<size_t,size_t>> path;
+    for(uint8_t h = hops[cell.first * cols + cell.second]; h != NO_HOP; h = hops[cell.first * cols + cell.second]){
+        cell = {cell.first + hopRow[h], cell.second + hopCol[h]};
+        path.push_back(cell);
+    }
+    return path;
+}
+
+bool ChargingGraph::isCharger(std::pair<size_t,size_t> cell) const{
+    auto it = nodeIndex.find(cell.first * cols + cell.second);
+    return it != nodeIndex.end() && it->second < chargersN;
+}
+
+int ChargingGraph::chargerSteps(size_t charger, std::pair<size_t,size_t> cell, TerrainType terrain) const{
+    if(terrain == TerrainType::AIR)
+        return manhattan(nodes[charger], cell);
+    if(chargerFields[charger].empty())
+        return bfsDistance(ground, nodes[charger], cell);
+    return chargerFields[charger][cell.first * cols + cell.second];
+}
+
+size_t ChargingGraph::getKeptFields() const{
+    size_t kept = 0;
+    for(auto& field : chargerFields)
+        kept += !field.empty();
+    return kept;
+}
+
+int ChargingGraph::steps(std::pair<size_t,size_t> from, std::pair<size_t,size_t> to, TerrainType terrain) const{
+    if(terrain == TerrainType::AIR)
+        return manhattan(from, to);
+
+    auto a = nodeIndex.find(from.first * cols + from.second);
+    auto b = nodeIndex.find(to.first * cols + to.second);
+    if(a != nodeIndex.end() && b != nodeIndex.end())
+        return groundLegs[a->second * nodes.size() + b->second];
+    if(a != nodeIndex.end() && a->second < chargersN)
+        return chargerSteps(a->second, to, terrain);
+    if(b != nodeIndex.end() && b->second < chargersN)
+        return chargerSteps(b->second, from, terrain);
+    return -1;
+}
+
+// arriving at a charger with zero battery is fine (it charges on the same tick), anywhere else it is not
+static bool canCover(const Agent& agent, int steps, size_t battery, bool toCharger){
+    if(steps < 0)
+        return false;
+    size_t energy = agent.energyFor(steps);
+    return toCharger ? energy <= battery : energy < battery;
+}
+
+// covers the steps to a cell and then the onward steps from it to its nearest charger, 0 when it is one
+static bool canFinish(const Agent& agent, int steps, size_t battery, int onward){
+    if(onward < 0)
+        return false;
+    if(onward == 0)
+        return canCover(agent, steps, battery, true);
+    return canCover(agent, steps, battery, false) && agent.energyFor(steps) + agent.energyFor(onward) <= battery;
+}
+
+ChargePlan ChargingGraph::plan(std::pair<size_t,size_t> from, std::pair<size_t,size_t> to, const Agent& agent, size_t battery, int directSteps) const{
+    ChargePlan result;
+    const TerrainType terrain = agent.getTerrain();
+    const size_t maxBattery = agent.getMaxBattery();
+    // a plan that leaves the agent at `to` unable to reach any charger is no plan
+    const int onward = isCharger(to) ? 0 : distanceToCharger(to, terrain);
+
+    if(directSteps < 0)
+        directSteps = steps(from, to, terrain);
+
+    if(canFinish(agent, directSteps, battery, onward)){
+        result.feasible = true;
+        result.ticks = agent.ticksFor(directSteps);
+        result.batteryLeft = battery - agent.energyFor(directSteps);
+        return result;
+    }
+
+    // Dijkstra over the chargers, every stop tops the battery up to full
+    std::vector<int> best(chargersN, INT_MAX);
+    std::vector<int> previous(chargersN, -1);
+    std::vector<bool> done(chargersN, false);
+
+    for(size_t i = 0; i < chargersN; i++){
+        int d = chargerSteps(i, from, terrain);
+        if(canCover(agent, d, battery, true))
+            best[i] = agent.ticksFor(d) + agent.chargeTicksFrom(battery - agent.energyFor(d));
+    }
+
+    while(true){
+        int u = -1;
+        for(size_t i = 0; i < chargersN; i++)
+            if(!done[i] && best[i] != INT_MAX && (u == -1 || best[i] < best[u]))
+                u = i;
+        if(u == -1)
+            break;
+        done[u] = true;
+
+        for(size_t v = 0; v < chargersN; v++){
+            if(done[v])
+                continue;
+            int d = groundLegs[u * nodes.size() + v];
+            if(terrain == TerrainType::AIR)
+                d = manhattan(nodes[u], nodes[v]);
+            if(!canCover(agent, d, maxBattery, true))
+                continue;
+            int candidate = best[u] + agent.ticksFor(d) + agent.chargeTicksFrom(maxBattery - agent.energyFor(d));
+            if(candidate < best[v]){
+                best[v] = candidate;
+                previous[v] = u;
+            }
+        }
+    }
+
+    int lastStop = -1;
+    int bestTotal = INT_MAX;
+    for(size_t i = 0; i < chargersN; i++){
+        if(best[i] == INT_MAX)
+            continue;
+        int d = chargerSteps(i, to, terrain);
+        if(!canFinish(agent, d, maxBattery, onward))
+            continue;
+        int total = best[i] + agent.ticksFor(d);
+        if(total < bestTotal){
+            bestTotal = total;
+            lastStop = i;
+            result.batteryLeft = maxBattery - agent.energyFor(d);
+        }
+    }
+
+    if(lastStop == -1)
+        return result;
+
+    result.feasible = true;
+    result.ticks = bestTotal;
+    for(int i = lastStop; i != -1; i = previous[i])
+        result.stops.insert(result.stops.begin(), nodes[i]);
+    return result;
+}
@@ -0,0 +1,161 @@
+#include "flowfield.h"
+#include "pathfinding.h"
+
+#include <queue>
+#include <limits>
+#include <functional>
+
+// N, S, W, E, the order aStar tries its neighbours in
+static const int hopRow[] = {-1,1,0,0};
+static const int hopCol[] = {0,0,-1,1};
+constexpr uint8_t NO_HOP = 255;
+
+void FlowFields::configure(bool _enabled, size_t _capacity, bool _pinClients){
+    enabled = _enabled;
+    capacity = _capacity;
+    pinClients = _pinClients;
+}
+
+void FlowFields::build(const CellGrid& map){
+    rows = map.size();
+    cols = rows ? map[0].size() : 0;
+    recent.clear();
+    cached.clear();
+    pinned.clear();
+    memory.resize(0);
+
+    std::vector<std::pair<size_t,size_t>> clients;
+    for(size_t i = 0; i < rows; i++)
+        for(size_t j = 0; j < cols; j++)
+            if(map[i][j] == Cell::BASE)
+                base = {i,j};
+            else if(map[i][j] == Cell::CLIENT)
+                clients.push_back({i,j});
+
+    for(TerrainType terrain : {TerrainType::AIR, TerrainType::GROUND})
+        for(bool low : {false, true})
+            baseFields[static_cast<int>(terrain)][low] = enabled ? compute(map, base, terrain, low) : nullptr;
+    if(!enabled)
+        return;
+    memory.resize(4 * bytesOfField());
+
+    // both cost regimes of a client or neither, a trip may switch regime halfway
+    if(pinClients)
+        for(std::pair<size_t,size_t> client : clients){
+            if(pinned.size() + 2 > capacity || !MemoryLedger::fits(MemorySubsystem::CACHES, 2 * bytesOfField()))
+                break;
+            for(bool low : {false, true})
+                pinned[keyOf(client, TerrainType::GROUND, low)] = compute(map, client, TerrainType::GROUND, low);
+            memory.resize(memory.getBytes() + 2 * bytesOfField());
+        }
+}
+
+bool FlowFields::covers(const CellGrid& map, std::pair<size_t,size_t> target) const{
+    if(!enabled || target.first >= rows || target.second >= cols)
+        return false;
+    Cell cell = map[target.first][target.second];
+    return cell == Cell::BASE || (cell == Cell::CLIENT && capacity > 0);
+}
+
+bool FlowFields::built(std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery) const{
+    return target == base || pinned.count(keyOf(target, terrain, lowBattery));
+}
+
+// Dijkstra outwards from the target: a cell's distance is the cheapest walk from it to the target, paying for
+// every cell stepped onto. Its hop is the first neighbour, in N, S, W, E order, that walk can continue through.
+std::shared_ptr<const FlowField> FlowFields::compute(const CellGrid& map, std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery) const{
+    const int unreached = std::numeric_limits<int>::max();
+    auto passable = [&](size_t i, size_t j){ return terrain == TerrainType::AIR || map[i][j] != Cell::WALL; };
+
+    std::vector<int> distance(rows * cols, unreached);
+    std::priority_queue<std::pair<int,size_t>, std::vector<std::pair<int,size_t>>, std::greater<std::pair<int,size_t>>> open;
+    distance[target.first * cols + target.second] = 0;
+    open.push({0, target.first * cols + target.second});
+
+    while(!open.empty()){
+        auto [d, u] = open.top();
+        open.pop();
+        if(d > distance[u])
+            continue;
+        // whoever steps here from a neighbour pays for this cell
+        int cost = d + stepCost(map[u / cols][u % cols], lowBattery);
+        for(int h = 0; h < 4; h++){
+            size_t ni = u / cols + hopRow[h], nj = u % cols + hopCol[h];
+            if(ni >= rows || nj >= cols || !passable(ni, nj))
+                continue;
+            if(cost < distance[ni * cols + nj]){
+                distance[ni * cols + nj] = cost;
+                open.push({cost, ni * cols + nj});
+            }
+        }
+    }
+
+    auto field = std::make_shared<FlowField>();
+    field->hops.assign(rows * cols, NO_HOP);
+    for(size_t i = 0; i < rows; i++)
+        for(size_t j = 0; j < cols; j++){
+            int d = distance[i * cols + j];
+            if(d == unreached || d == 0)
+                continue;
+            for(uint8_t h = 0; h < 4; h++){
+                size_t ni = i + hopRow[h], nj = j + hopCol[h];
+                if(ni < rows && nj < cols && distance[ni * cols + nj] != unreached &&
+                   distance[ni * cols + nj] + stepCost(map[ni][nj], lowBattery) == d){
+                    field->hops[i * cols + j] = h;
+                    break;
+                }
+            }
+        }
+    return field;
+}
+
+std::shared_ptr<const FlowField> FlowFields::clientField(const CellGrid& map, std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery){
+    size_t key = keyOf(target, terrain, lowBattery);
+    auto kept = pinned.find(key);
+    if(kept != pinned.end())
+        return kept->second;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = cached.find(key);
+        if(it != cached.end()){
+            recent.splice(recent.begin(), recent, it->second);
+            return it->second->second;
+        }
+    }
+
+    // built outside the lock, two threads missing on the same field both build it and the second one is dropped
+    std::shared_ptr<const FlowField> field = compute(map, target, terrain, lowBattery);
+
+    std::lock_guard<std::mutex> guard(lock);
+    if(cached.count(key))
+        return field;
+    // the pinned fields take their share of the cache
+    const size_t room = capacity - pinned.size();
+    while(!recent.empty() && (recent.size() >= room || !MemoryLedger::fits(MemorySubsystem::CACHES, bytesOfField()))){
+        cached.erase(recent.back().first);
+        recent.pop_back();
+        memory.resize(memory.getBytes() - bytesOfField());
+    }
+    if(recent.size() < room && MemoryLedger::fits(MemorySubsystem::CACHES, bytesOfField())){
+        recent.push_front({key, field});
+        cached[key] = recent.begin();
+        memory.resize(memory.getBytes() + bytesOfField());
+    }
+    return field;
+}
+
+std::vector<std::pair<size_t,size_t>> FlowFields::path(const CellGrid& map, std::pair<size_t,size_t> from, std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery){
+    if(from == target)
+        return {from};
+
+    std::shared_ptr<const FlowField> field = target == base ? baseFields[static_cast<int>(terrain)][lowBattery] : clientField(map, target, terrain, lowBattery);
+
+    std::vector<std::pair<size_t,size_t>> path;
+    for(uint8_t h = field->hops[from.first * cols + from.second]; h != NO_HOP; h = field->hops[from.first * cols + from.second]){
+        from = {from.first + hopRow[h], from.second + hopCol[h]};
+        path.push_back(from);
+    }
+    if(from != target)
+        path.clear();
+    return path;
+}
@@ -0,0 +1,76 @@
+#include "grid.h"
+
+#include <cctype>
+#include <algorithm>
+
+static size_t bitsFor(size_t n){
+    size_t bits = 0;
+    while((size_t(1) << bits) < n)
+        bits++;
+    return bits;
+}
+
+GridIndex::GridIndex(size_t _rows, size_t _cols, GridLayout _layout): layout(_layout), rows(_rows), cols(_cols){
+    switch(layout){
+        case GridLayout::TILED:
+        case GridLayout::CHUNKED:{
+            blockBits = layout == GridLayout::TILED ? TILE_BITS : CHUNK_BITS;
+            size_t block = size_t(1) << blockBits;
+            tilesPerRow = (cols + block - 1) / block;
+            slots = ((rows + block - 1) / block) * tilesPerRow * block * block;
+            break;
+        }
+        case GridLayout::MORTON:{
+            size_t rowBits = bitsFor(rows), colBits = bitsFor(cols);
+            shared = std::min(rowBits, colBits);
+            tallerThanWide = rowBits > colBits;
+            slots = rows && cols ? size_t(1) << (rowBits + colBits) : 0;
+            break;
+        }
+        default:
+            slots = rows * cols;
+    }
+}
+
+std::pair<size_t,size_t> GridIndex::cell(size_t index) const{
+    switch(layout){
+        case GridLayout::TILED:
+        case GridLayout::CHUNKED:{
+            size_t block = size_t(1) << blockBits;
+            size_t tile = index >> (2 * blockBits), within = index & (block * block - 1);
+            return {(tile / tilesPerRow) * block + (within >> blockBits), (tile % tilesPerRow) * block + (within & (block - 1))};
+        }
+        case GridLayout::MORTON:{
+            size_t low = index & ((size_t(1) << (2 * shared)) - 1), high = index >> (2 * shared);
+            size_t row = compact(low >> 1), col = compact(low);
+            if(tallerThanWide)
+                row |= high << shared;
+            else
+                col |= high << shared;
+            return {row, col};
+        }
+        default:
+            return {index / cols, index % cols};
+    }
+}
+
+const char* GridIndex::name(GridLayout layout){
+    switch(layout){
+        case GridLayout::TILED: return "tiled";
+        case GridLayout::MORTON: return "morton";
+        case GridLayout::CHUNKED: return "chunked";
+        default: return "row-major";
+    }
+}
+
+bool GridIndex::parse(const std::string& text, GridLayout& layout){
+    std::string lower;
+    for(char c : text)
+        lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    for(GridLayout candidate : {GridLayout::ROW_MAJOR, GridLayout::TILED, GridLayout::MORTON, GridLayout::CHUNKED})
+        if(lower == name(candidate)){
+            layout = candidate;
+            return true;
+        }
+    return false;
+}
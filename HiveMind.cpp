@@ -7,11 +7,11 @@
 #include <string>
 #include <sstream>
 #include <utility>
+#include <climits>
+#include <cmath>
 
 template<typename t>
-t getRandomNumber(t start, t end){
-    static std::random_device rd;   // seed
-    static std::mt19937 gen(rd());  // mersenne twister engine
+t getRandomNumber(std::mt19937& gen, t start, t end){
     std::uniform_int_distribution<t> dist(start , end);
     return dist(gen);
 }
@@ -49,7 +49,98 @@ bool HiveMind::loadSimulationFile(){
     readField<size_t>(fin,packagesN);
     readField<size_t>(fin,spawnFreqN);
 
+    // optional settings, in any order after the required ones
+    Policy policy = Policy::get();
+    while(std::getline(fin,line)){
+        std::istringstream option(line);
+        if(!(option >> label))
+            continue;
+        if(label == "COOPERATIVE_ROUTING:")
+            option >> cooperativeRouting;
+        else if(label == "RESERVATION_WINDOW:")
+            option >> reservationWindow;
+        else if(label == "EVENT_DRIVEN:")
+            option >> eventDriven;
+        else if(label == "SEED:")
+            option >> seed;
+        else if(label == "WORKER_THREADS:")
+            option >> workerThreads;
+        else if(label == "SHARDS:")
+            option >> shardsN;
+        else if(label == "WORKLOAD:")
+            option >> workload.model;
+        else if(label == "ARRIVAL_RATE:")
+            option >> workload.arrivalRate;
+        else if(label == "DIURNAL_PERIOD:")
+            option >> workload.diurnalPeriod;
+        else if(label == "DIURNAL_AMPLITUDE:")
+            option >> workload.diurnalAmplitude;
+        else if(label == "BURST_SIZE:")
+            option >> workload.burstSize;
+        else if(label == "CLIENT_SKEW:")
+            option >> workload.clientSkew;
+        else if(label == "TRACE_FILE:")
+            option >> workload.traceFile;
+        else if(label == "ORDER_PIPE:")
+            option >> workload.orderPipe;
+        else if(label == "ORDER_QUEUE:")
+            option >> workload.orderQueueSize;
+        else if(label == "INGEST_BATCH:")
+            option >> workload.ingestBatch;
+        else if(label == "FLOW_FIELDS:")
+            option >> flowFieldsEnabled;
+        else if(label == "FLOW_FIELD_CACHE:")
+            option >> flowFieldCache;
+        else if(label == "LANDMARKS:")
+            option >> landmarksN;
+        else if(label == "OPTIMIZE_ROUTES:")
+            option >> optimizeRoutes;
+        else if(label == "PLANNING_BUDGET:")
+            option >> planningBudget;
+        else if(label == "PLANNING_EPSILON:")
+            option >> planningEpsilon;
+        else if(label == "GRID_LAYOUT:"){
+            std::string name;
+            if(!(option >> name) || !GridIndex::parse(name, gridLayout))
+                std::cerr<<"Unknown GRID_LAYOUT in " << simulationFile << ", expected row-major, tiled, morton or chunked\n";
+        }
+        else if(label == "MAP_FILE:")
+            option >> mapFile;
+        else if(label == "PLACE_STATIONS:")
+            option >> placeStations;
+        else if(label == "STATUS_SOCKET:")
+            option >> statusSocket;
+        else if(label == "TUNE:")
+            option >> tuneEvaluations;
+        else if(label == "TUNE_SCENARIOS:")
+            option >> tuneScenarios;
+        else if(policy.read(label, option))
+            continue;
+        else if(label == "MEMORY_BUDGET:"){
+            std::string name;
+            size_t kib = 0;
+            MemorySubsystem subsystem;
+            if(option >> name >> kib && MemoryLedger::parse(name, subsystem))
+                MemoryLedger::setBudget(subsystem, kib * 1024);
+            else
+                std::cerr<<"Bad MEMORY_BUDGET in " << simulationFile << ", expected a subsystem and a size in KiB\n";
+        }
+        else
+            std::cerr<<"Unknown setting " << label << " in " << simulationFile << "\n";
+    }
+
     fin.close();
+    Policy::set(policy);
+
+    if(planningEpsilon < 1){
+        std::cerr<<"PLANNING_EPSILON below 1, searching optimal paths\n";
+        planningEpsilon = 1;
+    }
+
+    // mersenne twister for the map and the packages, fixed when a seed is given so runs can be replayed
+    if(seed == 0)
+        seed = std::random_device{}();
+    rng.seed(seed);
 
     if(dronesN + robotsN + scootersN == 0){
         std::cerr<<"No agents specified in the simulation file!\n";
@@ -87,8 +178,44 @@ bool HiveMind::loadSimulationFile(){
     return 1;
 }
 
-void HiveMind::setMap(std::vector<std::vector<Cell>> _map){
-    map = _map;
+void HiveMind::setMap(CellGrid _map){
+    map = std::move(_map);
+    mapVersion++;
+    // the builds below read every cell once, a chunked map pages through them within its budget
+    ChunkTable<Cell>* chunks = map.getChunks();
+    if(chunks){
+        chunks->compact();
+        chunks->setEvictOnLoad(true);
+    }
+    groundCells = BitGrid::passable(map, TerrainType::GROUND);
+    airCells = BitGrid::passable(map, TerrainType::AIR);
+    chargerCells = BitGrid::cellsOf(map, Cell::STATION, Cell::BASE);
+    mapMemory.resize(map.getBytes() + groundCells.getBytes() + airCells.getBytes() + chargerCells.getBytes());
+    chargingGraph.build(map);
+    flowFields.configure(flowFieldsEnabled, flowFieldCache, planningBudget > 0);
+    flowFields.build(map);
+    // node 0 of the charging graph is the base
+    if(!chargingGraph.getNodes().empty())
+        landmarks.build(map, groundCells, chargingGraph.getNodes()[0], landmarksN);
+    reservations.configure(reservationWindow, map.empty() ? 0 : map[0].size());
+    if(chunks)
+        chunks->setEvictOnLoad(false);
+}
+
+void HiveMind::pageMap(){
+    ChunkTable<Cell>* chunks = map.getChunks();
+    if(chunks == nullptr || MemoryLedger::fits(MemorySubsystem::MAP, 0))
+        return;
+
+    const GridIndex& index = map.getIndex();
+    std::vector<bool> keep(chunks->getCount(), false);
+    keep[index.chunkOf(getBaseCoords())] = true;
+    for(auto& agent : agents){
+        keep[index.chunkOf(agent->getCoordinates())] = true;
+        for(auto& cell : agent->getCurrentPath())
+            keep[index.chunkOf(cell)] = true;
+    }
+    chunks->evict(keep);
 }
 
 void HiveMind::setClients(std::vector<std::pair<size_t,size_t>> _clients){
@@ -105,21 +232,17 @@ void HiveMind::setAgents(std::vector<std::unique_ptr<Agent>> _agents){
 }
 
 std::pair<size_t,size_t> HiveMind::getRandomClient() {
-    return clients[getRandomNumber<int>(0,static_cast<int>(clients.size()-1))];
+    return clients[getRandomNumber<int>(rng,0,static_cast<int>(clients.size()-1))];
 }
 
-void HiveMind::createRandomPackage(size_t tick){
-    int randomReward = getRandomNumber<int>(200,800);
-    size_t randomDeadline = getRandomNumber<size_t>(10,20);
-    std::pair<size_t,size_t> randomClient = getRandomClient();
-    std::shared_ptr<Package> pkg = std::make_shared<Package>(randomClient,randomReward,randomDeadline,tick);
-    packages.push_back(pkg);
+void HiveMind::createPackage(size_t tick, std::pair<size_t,size_t> client, int reward, size_t deadline){
+    packages.push_back(packageStore.create(client,reward,deadline,tick));
 
     std::printf("Package created: client(%llu,%llu), reward(%d), deadline(%llu), firstTick(%llu), location(BASE)\n",
-        randomClient.first,
-        randomClient.second,
-        randomReward,
-        randomDeadline,
+        client.first,
+        client.second,
+        reward,
+        deadline,
         tick);
 }
 
@@ -136,16 +259,16 @@ void HiveMind::assignNextPackage(Agent& agent) {
     if (agent.getPackages().size() >= agent.getCapacity())
         return;
 
-    std::shared_ptr<Package> packagePtr = packages.front();
+    PackageHandle handle = packages.front();
     packages.erase(packages.begin());
 
-    packagePtr->agentId = agent.getId();
-    agent.getPackages().push_back(packagePtr);
+    Package &pkg = packageStore[handle];
+    pkg.agentId = static_cast<uint32_t>(agent.getId());
+    agent.addPackage(handle);
 
-    Package &pkg = *packagePtr;
     // log
     std::printf("Package assigned to agent#%llu at (%llu,%llu) (reward=%llu, deadline=%llu, client=(%llu,%llu))\n",
-                pkg.agentId,
+                agent.getId(),
                 agent.getCoordinates().first,
                 agent.getCoordinates().second,
                 pkg.reward,
@@ -154,86 +277,134 @@ void HiveMind::assignNextPackage(Agent& agent) {
                 pkg.client.second);
 }
 
-constexpr int DIST_WEIGHT = 10;       // weight for distance
-constexpr int STATION_WEIGHT = 5;     // weight for recharge stations
+constexpr int STRANDED_COST = 100000; // leg the agent cannot finish even with charge stops
+
+// Adds one leg of a route to the running totals, recharging when the battery cannot cover it
+static void addLegCost(HiveMind& hiveMind, Agent& agent, std::pair<size_t,size_t> from, std::pair<size_t,size_t> to, int& cost, int& stationCount, size_t& batteryLeft){
+    auto [dist, stations] = hiveMind.legDistance(agent.getTerrain(), from, to);
+
+    // Ticks needed related to agent's speed
+    int ticksNeeded = static_cast<int>(std::ceil(float(dist) / agent.getSpeed()));
+
+    // Reduce battery for this path
+    if (batteryLeft < ticksNeeded * agent.getConsumption()) {
+        // Agent needs to stop at stations along the way, the charging graph tells where and for how long
+        ChargePlan plan = hiveMind.getChargingGraph().plan(from, to, agent, batteryLeft, dist);
+        if (plan.feasible) {
+            batteryLeft = plan.batteryLeft;
+            cost += plan.ticks * Policy::get().distWeight;
+        } else {
+            batteryLeft = agent.getMaxBattery();
+            cost += STRANDED_COST;
+        }
+    } else {
+        batteryLeft -= ticksNeeded * agent.getConsumption();
+        cost += ticksNeeded * Policy::get().distWeight;
+    }
+
+    stationCount += stations;
+}
 
-void HiveMind::decidePackageAssignment() {
+std::pair<int,int> HiveMind::measureLeg(TerrainType terrain, std::pair<size_t,size_t> from, std::pair<size_t,size_t> to) const{
+    // cells a landmark tells apart are in different ground components, no need to flood one of them whole
+    if(terrain == TerrainType::GROUND && landmarks.separated(from, to))
+        return {-1,0};
+    return bfsDistance(getPassable(terrain), chargingGraph, terrain, from, to);
+}
+
+size_t HiveMind::legKey(TerrainType terrain, std::pair<size_t,size_t> from, std::pair<size_t,size_t> to) const{
+    size_t cols = map.empty() ? 0 : map[0].size();
+    size_t cells = map.size() * cols;
+    return ((from.first * cols + from.second) * cells + to.first * cols + to.second) * 2 + static_cast<int>(terrain);
+}
+
+std::pair<int,int> HiveMind::legDistance(TerrainType terrain, std::pair<size_t,size_t> from, std::pair<size_t,size_t> to){
+    size_t key = legKey(terrain, from, to);
+    auto it = legs.find(key);
+    if(it != legs.end())
+        return it->second;
+    return legs[key] = measureLeg(terrain, from, to);
+}
+
+void HiveMind::primeLegs(const std::vector<Leg>& measured){
+    for(const Leg& leg : measured)
+        legs[legKey(leg.terrain, leg.from, leg.to)] = leg.distance;
+}
+
+const RouteEstimate& HiveMind::committedRoute(Agent& agent){
+    RouteEstimate& route = agent.getRouteCache();
+    std::pair<size_t, size_t> agentCoords = agent.getCoordinates();
+
+    if (route.valid && route.origin == agentCoords && route.originBattery == agent.getCurrentBattery())
+        return route;
+
+    route.valid = true;
+    route.origin = agentCoords;
+    route.originBattery = agent.getCurrentBattery();
+    route.cost = 0;
+    route.stationCount = 0;
+    route.batteryLeft = agent.getCurrentBattery();
+
+    // Consider packages already in agent's possession
+    for (PackageHandle handle : agent.getPackages()) {
+        const Package& package = packageStore[handle];
+        if (package.location == Package::Location::AGENT) {
+            addLegCost(*this, agent, agentCoords, package.client, route.cost, route.stationCount, route.batteryLeft);
+            agentCoords = package.client;
+        }
+    }
+
+    // Return to base to pick up new package, an agent stranded away from it pays for that here
+    if (agentCoords != getBaseCoords()) {
+        addLegCost(*this, agent, agentCoords, getBaseCoords(), route.cost, route.stationCount, route.batteryLeft);
+        agentCoords = getBaseCoords();
+    }
+
+    route.endCoords = agentCoords;
+    return route;
+}
+
+size_t HiveMind::decidePackageAssignment() {
     if(packages.empty())
-        return;
+        return agents.size();
         
     int minCost = INT_MAX;
-    Agent* selectedAgent = nullptr;
+    size_t selected = agents.size();
+    const std::pair<size_t,size_t> client = packageStore[packages.front()].client;
 
-    for (auto& agent : agents) {
+    for (size_t i = 0; i < agents.size(); i++) {
+        Agent* agent = agents[i].get();
         if (agent->getState() == AgentState::DEAD)
             continue;
+        // a full agent would not take the package anyway
+        if (agent->getPackages().size() >= agent->getCapacity())
+            continue;
 
-        int cost = 0;
-        int stationCount = 0;
-        size_t batteryLeft = agent->getCurrentBattery();
-        std::pair<size_t, size_t> agentCoords = agent->getCoordinates();
-
-        // Consider packages already in agent's possession
-        if (agent->hasPackages() && agent->getPackages().size() < agent->getCapacity()) {
-            for (auto& package : agent->getPackages()) {
-                if (package->location == Package::Location::AGENT) {
-                    auto [dist, stations] = bfsDistance(map, agentCoords, package->client, *agent);
-
-                    // Ticks needed related to agent's speed
-                    int ticksNeeded = static_cast<int>(std::ceil(float(dist) / agent->getSpeed()));
-
-                    // Reduce battery for this path
-                    if (batteryLeft < ticksNeeded * agent->getConsumption()) {
-                        // Agent needs to stop at stations along the way
-                        batteryLeft = agent->getMaxBattery();
-                        cost += (ticksNeeded + stations) * DIST_WEIGHT; // extra cost for recharging delay
-                    } else {
-                        batteryLeft -= ticksNeeded * agent->getConsumption();
-                        cost += ticksNeeded * DIST_WEIGHT;
-                    }
-
-                    stationCount += stations;
-                    agentCoords = package->client;
-                }
-            }
-
-            // Return to base to pick up new package
-            auto [dist, stations] = bfsDistance(map, agentCoords, getBaseCoords(), *agent);
-            int ticksNeeded = static_cast<int>(std::ceil(float(dist) / agent->getSpeed()));
-            if (batteryLeft < ticksNeeded * agent->getConsumption()) {
-                batteryLeft = agent->getMaxBattery();
-                cost += (ticksNeeded + stations) * DIST_WEIGHT;
-            } else {
-                batteryLeft -= ticksNeeded * agent->getConsumption();
-                cost += ticksNeeded * DIST_WEIGHT;
-            }
-            stationCount += stations;
-            agentCoords = getBaseCoords();
-        }
+        const RouteEstimate& route = committedRoute(*agent);
+        int cost = route.cost;
+        int stationCount = route.stationCount;
+        size_t batteryLeft = route.batteryLeft;
 
         // Now consider the new package at base
-        auto [dist, stations] = bfsDistance(map, agentCoords, packages.front()->client, *agent);
-        int ticksNeeded = static_cast<int>(std::ceil(float(dist) / agent->getSpeed()));
-        if (batteryLeft < ticksNeeded * agent->getConsumption()) {
-            batteryLeft = agent->getMaxBattery();
-            cost += (ticksNeeded + stations) * DIST_WEIGHT;
-        } else {
-            batteryLeft -= ticksNeeded * agent->getConsumption();
-            cost += ticksNeeded * DIST_WEIGHT;
-        }
-        stationCount += stations;
+        addLegCost(*this, *agent, route.endCoords, client, cost, stationCount, batteryLeft);
+
+        // and the agent still has to reach a charger once the package is delivered, on what the trip left it
+        int toCharger = chargingGraph.distanceToCharger(client, agent->getTerrain());
+        if (toCharger < 0 || batteryLeft < agent->energyFor(toCharger))
+            cost += STRANDED_COST;
 
         // Prefer paths with recharge stations
-        cost -= stationCount * STATION_WEIGHT;
+        cost -= stationCount * Policy::get().stationWeight;
 
         if (cost < minCost) {
             minCost = cost;
-            selectedAgent = agent.get();
+            selected = i;
         }
     }
 
-    if (selectedAgent != nullptr)
-        assignNextPackage(*selectedAgent);
+    if (selected < agents.size())
+        assignNextPackage(*agents[selected]);
+    return selected;
 }
 
 
@@ -246,5 +417,45 @@ void HiveMind::printSimulationParameters(){
     std::cout<< "Robots: " << robotsN << std::endl;
     std::cout<< "Scooters: " << scootersN << std::endl;
     std::cout<< "Total packages: " << packagesN << std::endl;
-    std::cout<< "Spawn frequency: " << spawnFreqN << std::endl << std::endl;
+    std::cout<< "Spawn frequency: " << spawnFreqN << std::endl;
+    if(eventDriven)
+        std::cout<< "Event driven engine" << std::endl;
+    if(cooperativeRouting)
+        std::cout<< "Cooperative routing, reservation window: " << reservationWindow << std::endl;
+    if(workload.model != "fixed")
+        std::cout<< "Workload: " << workload.model << std::endl;
+    if(!workload.orderPipe.empty())
+        std::cout<< "Live orders from " << workload.orderPipe << ", up to " << workload.ingestBatch << " per tick" << std::endl;
+    if(!flowFieldsEnabled)
+        std::cout<< "Flow fields off, every trip is searched" << std::endl;
+    else
+        std::cout<< "Flow field cache: " << flowFieldCache << " client fields" << std::endl;
+    if(landmarksN > 0)
+        std::cout<< "Landmarks: " << landmarksN << std::endl;
+    if(!optimizeRoutes)
+        std::cout<< "Deliveries in assignment order" << std::endl;
+    if(planningBudget > 0)
+        std::cout<< "Planning budget: " << planningBudget << " cells per tick for the fleet, first paths within " << planningEpsilon << " of optimal" << std::endl;
+    if(gridLayout != GridLayout::ROW_MAJOR)
+        std::cout<< "Grid layout: " << GridIndex::name(gridLayout) << std::endl;
+    if(!mapFile.empty())
+        std::cout<< "Map loaded from " << mapFile << std::endl;
+    else if(placeStations)
+        std::cout<< "Stations placed near the clients" << std::endl;
+    if(tuneEvaluations > 0)
+        std::cout<< "Tuning: " << tuneEvaluations << " policies over " << tuneScenarios << " scenarios" << std::endl;
+    if(!Policy::get().isDefault())
+        Policy::get().write(stdout);
+    if(workerThreads > 1)
+        std::cout<< "Worker threads: " << workerThreads << std::endl;
+    if(!statusSocket.empty())
+        std::cout<< "Live state on " << statusSocket << std::endl;
+    if(shardsN > 1)
+        std::cout<< "Shard processes: " << shardsN << std::endl;
+    for(int i = 0; i < static_cast<int>(MemorySubsystem::COUNT); i++){
+        MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+        if(MemoryLedger::getBudget(subsystem) > 0)
+            std::cout<< "Memory budget " << MemoryLedger::name(subsystem) << ": " << MemoryLedger::getBudget(subsystem) / 1024 << " KiB" << std::endl;
+    }
+    std::cout<< std::endl;
 }
\ No newline at end of file
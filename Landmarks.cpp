@@ -0,0 +1,94 @@
+#include "landmarks.h"
+#include "pathfinding.h"
+
+#include <queue>
+#include <functional>
+
+static const int hopRow[] = {-1,1,0,0};
+static const int hopCol[] = {0,0,-1,1};
+
+// Dijkstra over the ground from one landmark, every step paying for the cell it enters. Outwards gives the
+// cheapest walk from the landmark to each cell, inwards the cheapest walk from each cell to the landmark.
+static std::vector<int> walkCosts(const CellGrid& map, std::pair<size_t,size_t> landmark, bool lowBattery, bool outwards){
+    const size_t rows = map.size(), cols = map[0].size();
+    std::vector<int> cost(rows * cols, -1);
+    std::priority_queue<std::pair<int,size_t>, std::vector<std::pair<int,size_t>>, std::greater<std::pair<int,size_t>>> open;
+    cost[landmark.first * cols + landmark.second] = 0;
+    open.push({0, landmark.first * cols + landmark.second});
+
+    while(!open.empty()){
+        auto [d, u] = open.top();
+        open.pop();
+        if(d > cost[u])
+            continue;
+        size_t ui = u / cols, uj = u % cols;
+        for(int h = 0; h < 4; h++){
+            size_t ni = ui + hopRow[h], nj = uj + hopCol[h];
+            if(ni >= rows || nj >= cols || map[ni][nj] == Cell::WALL)
+                continue;
+            // outwards the neighbour is entered, inwards the walk enters u from it
+            int next = d + stepCost(outwards ? map[ni][nj] : map[ui][uj], lowBattery);
+            size_t v = ni * cols + nj;
+            if(cost[v] < 0 || next < cost[v]){
+                cost[v] = next;
+                open.push({next, v});
+            }
+        }
+    }
+    return cost;
+}
+
+void Landmarks::build(const CellGrid& map, const BitGrid& ground, std::pair<size_t,size_t> base, size_t wanted){
+    rows = map.size();
+    cols = rows ? map[0].size() : 0;
+    count = 0;
+    chosen.clear();
+    table.clear();
+    memory.resize(0);
+    if(wanted == 0 || rows == 0 || cols == 0 || !ground.test(base))
+        return;
+
+    const size_t cells = rows * cols;
+    const size_t landmarkBytes = 4 * cells * sizeof(int);
+
+    // picked by steps, the distance from the closest landmark so far; the base stands in for the first pick
+    std::vector<int> closest = distanceField(ground, base);
+    while(chosen.size() < wanted && MemoryLedger::fits(MemorySubsystem::CACHES, (chosen.size() + 1) * landmarkBytes)){
+        size_t farthest = cells;
+        for(size_t c = 0; c < cells; c++)
+            if(closest[c] > 0 && (farthest == cells || closest[c] > closest[farthest]))
+                farthest = c;
+        if(farthest == cells)
+            break;
+
+        chosen.push_back({farthest / cols, farthest % cols});
+        std::vector<int> steps = distanceField(ground, chosen.back());
+        // the first landmark replaces the base, it is not one itself
+        for(size_t c = 0; c < cells; c++)
+            if(steps[c] >= 0)
+                closest[c] = chosen.size() == 1 ? steps[c] : std::min(closest[c], steps[c]);
+    }
+
+    count = chosen.size();
+    table.assign(cells * 4 * count, -1);
+    for(size_t k = 0; k < count; k++)
+        for(bool low : {false, true})
+            for(bool outwards : {true, false}){
+                std::vector<int> cost = walkCosts(map, chosen[k], low, outwards);
+                size_t slot = (outwards ? 0 : count) + k;
+                for(size_t c = 0; c < cells; c++)
+                    table[(c * 2 + low) * 2 * count + slot] = cost[c];
+            }
+    memory.resize(bytesOf(table));
+}
+
+bool Landmarks::separated(std::pair<size_t,size_t> a, std::pair<size_t,size_t> b) const{
+    if(count == 0)
+        return false;
+    const int* ca = costs(a, false);
+    const int* cb = costs(b, false);
+    for(size_t k = 0; k < count; k++)
+        if((ca[k] < 0) != (cb[k] < 0))
+            return true;
+    return false;
+}
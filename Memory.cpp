@@ -0,0 +1,67 @@
+#include "memory.h"
+
+#include <cctype>
+
+constexpr int SUBSYSTEMS = static_cast<int>(MemorySubsystem::COUNT);
+
+std::atomic<int64_t> MemoryLedger::current[SUBSYSTEMS] = {};
+std::atomic<int64_t> MemoryLedger::peak[SUBSYSTEMS] = {};
+size_t MemoryLedger::budget[SUBSYSTEMS] = {};
+
+static const char* subsystemNames[SUBSYSTEMS] = {"map", "agents", "routes", "packages", "pathfinding", "caches", "logs"};
+
+void MemoryLedger::add(MemorySubsystem subsystem, int64_t bytes){
+    int i = static_cast<int>(subsystem);
+    int64_t now = current[i].fetch_add(bytes) + bytes;
+    int64_t highest = peak[i].load();
+    while(now > highest && !peak[i].compare_exchange_weak(highest, now));
+}
+
+bool MemoryLedger::fits(MemorySubsystem subsystem, size_t extra){
+    int i = static_cast<int>(subsystem);
+    return budget[i] == 0 || getCurrent(subsystem) + extra <= budget[i];
+}
+
+void MemoryLedger::setBudget(MemorySubsystem subsystem, size_t bytes){
+    budget[static_cast<int>(subsystem)] = bytes;
+}
+
+size_t MemoryLedger::getCurrent(MemorySubsystem subsystem){
+    int64_t bytes = current[static_cast<int>(subsystem)].load();
+    return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+}
+
+size_t MemoryLedger::getPeak(MemorySubsystem subsystem){
+    int64_t bytes = peak[static_cast<int>(subsystem)].load();
+    return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+}
+
+const char* MemoryLedger::name(MemorySubsystem subsystem){
+    return subsystemNames[static_cast<int>(subsystem)];
+}
+
+bool MemoryLedger::parse(const std::string& text, MemorySubsystem& subsystem){
+    std::string lower;
+    for(char c : text)
+        lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    for(int i = 0; i < SUBSYSTEMS; i++)
+        if(lower == subsystemNames[i]){
+            subsystem = static_cast<MemorySubsystem>(i);
+            return true;
+        }
+    return false;
+}
+
+MemoryCharge::MemoryCharge(MemorySubsystem _subsystem, size_t _bytes): subsystem(_subsystem){
+    resize(_bytes);
+}
+
+MemoryCharge::~MemoryCharge(){
+    resize(0);
+}
+
+void MemoryCharge::resize(size_t _bytes){
+    if(_bytes != bytes)
+        MemoryLedger::add(subsystem, static_cast<int64_t>(_bytes) - static_cast<int64_t>(bytes));
+    bytes = _bytes;
+}
@@ -3,10 +3,14 @@
 #include <cmath>
 #include <limits>
 #include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "types.h"
 #include "agents/agents.h"
 #include "pathfinding.h"
+#include "bitgrid.h"
+#include "memory.h"
 
 struct Node {
     Pair coord;
@@ -19,95 +23,161 @@ inline int heuristic(Pair a, Pair b) {
     return std::abs((int)a.first - (int)b.first) + std::abs((int)a.second - (int)b.second);
 }
 
+// Lower bound on the cost still ahead of a search: of the walk from a cell to the goal, or for the backward half
+// of a bidirectional search, of the walk from the goal (its start) to the cell. Without landmarks it is the
+// Manhattan distance, as it always was; with them the larger of the landmark bound and the Manhattan distance
+// at the cheapest step of the policy. Both are consistent, so is their maximum.
+class Estimate{
+    const Landmarks* landmarks = nullptr;
+    Pair goal;
+    bool backward;
+    const int* goalCosts = nullptr;
+    bool lowBattery = false;
+    int cheapest = 1;
+
+    public:
+        Estimate(const Landmarks* _landmarks, const Agent& agent, Pair _goal, bool _backward = false):
+        Estimate(agent.getTerrain() == TerrainType::GROUND ? _landmarks : nullptr,
+                 ::lowBattery(agent.getCurrentBattery(), agent.getMaxBattery()), _goal, _backward){}
+
+        // a ground search whose cost regime is fixed
+        Estimate(const Landmarks* _landmarks, bool _lowBattery, Pair _goal, bool _backward = false):
+        landmarks(_landmarks), goal(_goal), backward(_backward){
+            if(!landmarks || landmarks->getCount() == 0)
+                return;
+            lowBattery = _lowBattery;
+            goalCosts = landmarks->costs(goal, lowBattery);
+            const Policy& policy = Policy::get();
+            cheapest = std::min({policy.roadCost, policy.clientCost, policy.stationLowCost, policy.stationHighCost});
+        }
+
+        int operator()(Pair cell) const {
+            int steps = heuristic(cell, goal);
+            if(!goalCosts)
+                return steps;
+            const int* cellCosts = landmarks->costs(cell, lowBattery);
+            int bound = backward ? landmarks->bound(goalCosts, cellCosts) : landmarks->bound(cellCosts, goalCosts);
+            return std::max(bound, steps * cheapest);
+        }
+};
+
 inline bool isValid(Pair c, size_t rows, size_t cols) {
     return c.first < rows && c.second < cols;
 }
 
-constexpr int ROAD_COST = 10;
-constexpr int CLIENT_COST = 6;
-constexpr int STATION_HIGH_COST = 30; 
-constexpr int STATION_LOW_COST  = 2;
-
 inline int getG(Cell cell, size_t currentBattery, size_t maxBattery) {
-    if (cell == Cell::STATION || cell == Cell::BASE) {
-        // the condition is the same with currentBattery*100 / maxBattery <= 10, but it is okay for size_t and bug-free
-        if (currentBattery * 100 <= 25 * maxBattery) {
-            return STATION_LOW_COST;
-        } else {
-            return STATION_HIGH_COST;
-        }
-    }
-
-    if (cell == Cell::CLIENT)
-        return CLIENT_COST;
-
-    return ROAD_COST;
+    return stepCost(cell, lowBattery(currentBattery, maxBattery));
 }
 
 
-inline bool isPassable(const std::vector<std::vector<Cell>>& map, Pair c,Agent& agent) {
+inline bool isPassable(const CellGrid& map, Pair c,Agent& agent) {
     if(agent.getTerrain() == TerrainType::AIR)
         return true;
     else
         return map[c.first][c.second] != Cell::WALL;
 }
 
-std::vector<Pair> aStar(const std::vector<std::vector<Cell>>& map, Pair start, Pair end, Agent& agent) {
-    if(start == end){
-        return {start};
+// Below this Manhattan distance a single search is cheaper than running two
+constexpr int BIDIRECTIONAL_MIN_DISTANCE = 32;
+
+static std::vector<Pair> aStarBidirectional(const CellGrid& map, Pair start, Pair end, Agent& agent, const Landmarks* landmarks);
+
+// Buffers of the one-sided search, kept per thread between calls. A cell is reached or closed only when its
+// stamp is the current search's, so nothing has to be cleared for the next one. Over the PATHFINDING budget
+// they are freed after every search instead.
+struct SearchScratch{
+    std::vector<int> g;
+    std::vector<size_t> parents;
+    std::vector<uint32_t> reached, closed;
+    uint32_t stamp = 0;
+    MemoryCharge memory{MemorySubsystem::PATHFINDING};
+
+    void prepare(size_t cells){
+        if(g.size() < cells){
+            g.resize(cells);
+            parents.resize(cells);
+            reached.assign(cells, 0);
+            closed.assign(cells, 0);
+            stamp = 0;
+        }
+        if(++stamp == 0){
+            std::fill(reached.begin(), reached.end(), 0);
+            std::fill(closed.begin(), closed.end(), 0);
+            stamp = 1;
+        }
+        memory.resize(bytesOf(g) + bytesOf(parents) + bytesOf(reached) + bytesOf(closed));
     }
+
+    void shrinkOverBudget(){
+        if(MemoryLedger::fits(MemorySubsystem::PATHFINDING, 0))
+            return;
+        std::vector<int>().swap(g);
+        std::vector<size_t>().swap(parents);
+        std::vector<uint32_t>().swap(reached);
+        std::vector<uint32_t>().swap(closed);
+        stamp = 0;
+        memory.resize(0);
+    }
+};
+
+static std::vector<Pair> aStarOneSided(const CellGrid& map, Pair start, Pair end, Agent& agent, SearchScratch& scratch, const Landmarks* landmarks) {
     size_t rows = map.size();
     size_t cols = map[0].size();
-
-    std::vector<std::vector<bool>> closed(rows, std::vector<bool>(cols, false));
-    std::vector<std::vector<Pair>> parents(rows, std::vector<Pair>(cols, {-1,-1}));
+    // the scratch arrays follow the map's layout, so a vertical step stays as close in them as in the map
+    const GridIndex& index = map.getIndex();
+    const uint32_t stamp = scratch.stamp;
+    std::vector<int>& g = scratch.g;
+    std::vector<size_t>& parents = scratch.parents;
+    std::vector<uint32_t>& reached = scratch.reached;
+    std::vector<uint32_t>& closed = scratch.closed;
+    Estimate estimate(landmarks, agent, end);
+    auto gOf = [&](size_t u){ return reached[u] == stamp ? g[u] : std::numeric_limits<int>::max(); };
 
     struct PQNode { Pair coord; int f; };
     auto cmp = [](const PQNode &a, const PQNode &b){ return a.f > b.f; };
     std::priority_queue<PQNode, std::vector<PQNode>, decltype(cmp)> open(cmp);
-    
 
-    std::vector<std::vector<int>> g(rows, std::vector<int>(cols, std::numeric_limits<int>::max()));
-
-    g[start.first][start.second] = 0;
-    open.push({start, heuristic(start,end)});
-    parents[start.first][start.second] = start;
+    size_t first = index(start);
+    g[first] = 0;
+    reached[first] = stamp;
+    parents[first] = first;
+    open.push({start, estimate(start)});
 
     std::vector<Pair> directions = {{-1,0},{1,0},{0,-1},{0,1}}; // N, S, W, E
 
     while(!open.empty()) {
         Pair curr = open.top().coord;
         open.pop();
+        size_t u = index(curr);
 
         if(curr == end) {
             // reconstruct path
             std::vector<Pair> path;
-            Pair p = end;
-            while(p != start) {
-                path.push_back(p);
-                p = parents[p.first][p.second];
-            }
+            for(size_t p = u; p != first; p = parents[p])
+                path.push_back(index.cell(p));
             std::reverse(path.begin(), path.end());
             return path;
         }
 
-        if(closed[curr.first][curr.second]) continue;
-        closed[curr.first][curr.second] = true;
+        if(closed[u] == stamp) continue;
+        closed[u] = stamp;
 
         for(Pair d : directions) {
             int ni = curr.first + d.first;
             int nj = curr.second + d.second;
             Pair neighbor = {ni, nj};
+            size_t v = index(neighbor);
 
-            if(!isValid(neighbor, rows, cols) || !isPassable(map, neighbor,agent) || closed[ni][nj])
+            if(!isValid(neighbor, rows, cols) || !isPassable(map, neighbor,agent) || closed[v] == stamp)
                 continue;
 
-            int tentativeG = g[curr.first][curr.second] + getG(map[ni][nj],agent.getCurrentBattery(),agent.getMaxBattery());
-            if(tentativeG < g[ni][nj]) {
-                g[ni][nj] = tentativeG;
-                int f = tentativeG + heuristic(neighbor, end);
+            int tentativeG = g[u] + getG(map[ni][nj],agent.getCurrentBattery(),agent.getMaxBattery());
+            if(tentativeG < gOf(v)) {
+                g[v] = tentativeG;
+                reached[v] = stamp;
+                int f = tentativeG + estimate(neighbor);
                 open.push({neighbor, f});
-                parents[ni][nj] = curr;
+                parents[v] = u;
             }
         }
     }
@@ -115,53 +185,344 @@ std::vector<Pair> aStar(const std::vector<std::vector<Cell>>& map, Pair start, P
     return {};
 }
 
-std::pair<int,int> bfsDistance(const std::vector<std::vector<Cell>>& map, Pair start, Pair end, Agent& agent){
-    const size_t rows = map.size();
-    const size_t cols = map[0].size();
+std::vector<Pair> aStar(const CellGrid& map, Pair start, Pair end, Agent& agent, const Landmarks* landmarks) {
+    if(start == end){
+        return {start};
+    }
+    if(agent.getTerrain() == TerrainType::GROUND && heuristic(start, end) >= BIDIRECTIONAL_MIN_DISTANCE)
+        return aStarBidirectional(map, start, end, agent, landmarks);
+
+    static thread_local SearchScratch scratch;
+    scratch.prepare(map.getIndex().size());
+    std::vector<Pair> path = aStarOneSided(map, start, end, agent, scratch, landmarks);
+    scratch.shrinkOverBudget();
+    return path;
+}
 
-    std::vector<std::vector<bool>> visited(rows, std::vector<bool>(cols, false));
-    std::queue<std::pair<Pair, int>> q; // ((x,y), distance)
+// Forward search from start and backward search from end, each with its own Manhattan heuristic. Every
+// search settles the cheaper side first and stops once neither open list can beat the best meeting point,
+// so the path costs the same as the one-sided aStar.
+static std::vector<Pair> aStarBidirectional(const CellGrid& map, Pair start, Pair end, Agent& agent, const Landmarks* landmarks) {
+    size_t rows = map.size();
+    size_t cols = map[0].size();
+    const int unreached = std::numeric_limits<int>::max();
+    const size_t none = std::numeric_limits<size_t>::max();
+    const GridIndex& index = map.getIndex();
+    const size_t slots = index.size();
+
+    // side 0 runs forward, side 1 backward; link is the parent going forward and the next cell going backward
+    std::vector<int> g[2] = {std::vector<int>(slots, unreached), std::vector<int>(slots, unreached)};
+    std::vector<size_t> link[2] = {std::vector<size_t>(slots, none), std::vector<size_t>(slots, none)};
+    std::vector<bool> closed[2] = {std::vector<bool>(slots, false), std::vector<bool>(slots, false)};
+    Estimate estimate[2] = {Estimate(landmarks, agent, end), Estimate(landmarks, agent, start, true)};
+    MemoryCharge scratch(MemorySubsystem::PATHFINDING, 2 * (bytesOf(g[0]) + bytesOf(link[0]) + closed[0].capacity() / 8));
 
-    int stationDensityHint = 0;
+    struct PQNode { Pair coord; int f; };
+    auto cmp = [](const PQNode &a, const PQNode &b){ return a.f > b.f; };
+    std::priority_queue<PQNode, std::vector<PQNode>, decltype(cmp)> open[2] = {
+        std::priority_queue<PQNode, std::vector<PQNode>, decltype(cmp)>(cmp),
+        std::priority_queue<PQNode, std::vector<PQNode>, decltype(cmp)>(cmp)
+    };
+
+    g[0][index(start)] = 0;
+    g[1][index(end)] = 0;
+    open[0].push({start, estimate[0](start)});
+    open[1].push({end, estimate[1](end)});
+
+    int best = unreached;
+    size_t meet = none;
+
+    std::vector<Pair> directions = {{-1,0},{1,0},{0,-1},{0,1}}; // N, S, W, E
+
+    while(!open[0].empty() && !open[1].empty()) {
+        // each open list lower-bounds every path not found yet
+        if(std::max(open[0].top().f, open[1].top().f) >= best)
+            break;
+
+        int side = open[0].size() <= open[1].size() ? 0 : 1;
+        Pair curr = open[side].top().coord;
+        open[side].pop();
+        size_t u = index(curr);
+
+        if(closed[side][u]) continue;
+        closed[side][u] = true;
+
+        for(Pair d : directions) {
+            int ni = curr.first + d.first;
+            int nj = curr.second + d.second;
+            Pair neighbor = {ni, nj};
+
+            if(!isValid(neighbor, rows, cols) || !isPassable(map, neighbor,agent))
+                continue;
+
+            // going forward the neighbour is entered, going backward the current cell is
+            Pair entered = side == 0 ? neighbor : curr;
+            size_t v = index(neighbor);
+            int tentativeG = g[side][u] + getG(map[entered.first][entered.second],agent.getCurrentBattery(),agent.getMaxBattery());
+
+            if(tentativeG < g[side][v]) {
+                g[side][v] = tentativeG;
+                link[side][v] = u;
+                open[side].push({neighbor, tentativeG + estimate[side](neighbor)});
+
+                if(g[1 - side][v] != unreached && tentativeG + g[1 - side][v] < best) {
+                    best = tentativeG + g[1 - side][v];
+                    meet = v;
+                }
+            }
+        }
+    }
+
+    if(meet == none)
+        return {};
+
+    // start .. meet from the forward parents, then meet .. end from the backward links
+    std::vector<Pair> path;
+    for(size_t p = meet; p != index(start); p = link[0][p])
+        path.push_back(index.cell(p));
+    std::reverse(path.begin(), path.end());
+    for(size_t p = link[1][meet]; p != none; p = link[1][p])
+        path.push_back(index.cell(p));
+    return path;
+}
+
+void startSearch(AnytimeSearch& search, const CellGrid& map, Pair start, Pair goal, double epsilon, bool lowBattery, const Landmarks* landmarks) {
+    search.clear();
+    search.path.clear();
+    search.start = start;
+    search.goal = goal;
+    search.epsilon = epsilon;
+    search.lowBattery = lowBattery;
+
+    size_t first = map.getIndex()(start);
+    search.reached[first] = {0, first};
+    search.open.push_back({static_cast<int>(epsilon * Estimate(landmarks, lowBattery, goal)(start)), first});
+}
+
+SearchStatus continueSearch(AnytimeSearch& search, const CellGrid& map, const Landmarks* landmarks, size_t& budget) {
+    if(search.start == search.goal){
+        search.clear();
+        search.path = {search.start};
+        return SearchStatus::FOUND;
+    }
+
+    size_t rows = map.size();
+    size_t cols = map[0].size();
+    const GridIndex& index = map.getIndex();
+    const size_t first = index(search.start);
+    const size_t last = index(search.goal);
+    Estimate estimate(landmarks, search.lowBattery, search.goal);
+    auto cmp = [](const AnytimeSearch::Open& a, const AnytimeSearch::Open& b){ return a.f > b.f; };
+
+    std::vector<Pair> directions = {{-1,0},{1,0},{0,-1},{0,1}}; // N, S, W, E
+
+    while(!search.open.empty()) {
+        size_t u = search.open.front().cell;
+        if(u == last) {
+            for(size_t p = u; p != first; p = search.reached[p].second)
+                search.path.push_back(index.cell(p));
+            std::reverse(search.path.begin(), search.path.end());
+            search.clear();
+            return SearchStatus::FOUND;
+        }
+        if(search.closed.count(u)) {
+            std::pop_heap(search.open.begin(), search.open.end(), cmp);
+            search.open.pop_back();
+            continue;
+        }
+        // the top stays in the heap until it is expanded, so a paused search picks up exactly there
+        if(budget == 0)
+            return SearchStatus::RUNNING;
+        budget--;
+        std::pop_heap(search.open.begin(), search.open.end(), cmp);
+        search.open.pop_back();
+        search.closed.insert(u);
+
+        Pair curr = index.cell(u);
+        int g = search.reached[u].first;
+        for(Pair d : directions) {
+            int ni = curr.first + d.first;
+            int nj = curr.second + d.second;
+            Pair neighbor = {ni, nj};
+
+            if(!isValid(neighbor, rows, cols) || map[ni][nj] == Cell::WALL)
+                continue;
+            size_t v = index(neighbor);
+            if(search.closed.count(v))
+                continue;
+
+            int tentativeG = g + stepCost(map[ni][nj], search.lowBattery);
+            auto it = search.reached.find(v);
+            if(it == search.reached.end() || tentativeG < it->second.first) {
+                search.reached[v] = {tentativeG, u};
+                search.open.push_back({tentativeG + static_cast<int>(search.epsilon * estimate(neighbor)), v});
+                std::push_heap(search.open.begin(), search.open.end(), cmp);
+            }
+        }
+    }
+
+    search.clear();
+    return SearchStatus::UNREACHABLE;
+}
+
+// Base and stations hold any number of agents, so they are never reserved
+inline bool isDock(Cell cell) {
+    return cell == Cell::BASE || cell == Cell::STATION;
+}
+
+std::vector<Pair> aStar(const CellGrid& map, Pair start, Pair end, Agent& agent, const ReservationTable& reservations, const Landmarks* landmarks) {
+    if(agent.getTerrain() == TerrainType::AIR || start == end)
+        return aStar(map, start, end, agent, landmarks);
+
+    size_t rows = map.size();
+    size_t cols = map[0].size();
+
+    // a state is a cell plus the number of moves made so far; past the window time no longer matters,
+    // so the move count is capped there and the search becomes a plain spatial A*
+    const size_t speed = agent.getSpeed();
+    const size_t horizon = reservations.getWindow() * speed;
+    const size_t startTick = reservations.getNow();
+    auto key = [&](Pair c, size_t moves) { return (c.first * cols + c.second) * (horizon + 1) + moves; };
+    auto tickOf = [&](size_t moves) { return startTick + (moves - 1) / speed; };
+
+    struct PQNode { Pair coord; size_t moves; int f; };
+    auto cmp = [](const PQNode &a, const PQNode &b){ return a.f > b.f; };
+    std::priority_queue<PQNode, std::vector<PQNode>, decltype(cmp)> open(cmp);
 
-    visited[start.first][start.second] = true;
-    q.push({start, 0});
+    std::unordered_map<size_t,int> g;
+    std::unordered_map<size_t,size_t> parents;
+    std::unordered_set<size_t> closed;
 
-    std::vector<Pair> directions = {
-        {1,0}, {-1,0}, {0,1}, {0,-1}
+    // node based tables, charged at roughly a node plus a bucket per entry when the search ends
+    MemoryCharge scratch(MemorySubsystem::PATHFINDING);
+    auto charge = [&](){
+        size_t entries = g.size() + parents.size() + closed.size();
+        size_t buckets = g.bucket_count() + parents.bucket_count() + closed.bucket_count();
+        scratch.resize(entries * (2 * sizeof(size_t) + sizeof(void*)) + buckets * sizeof(void*));
     };
 
-    while (!q.empty()) {
-        auto [c, dist] = q.front();
-        q.pop();
+    Estimate estimate(landmarks, agent, end);
+    g[key(start,0)] = 0;
+    open.push({start, 0, estimate(start)});
+
+    std::vector<Pair> directions = {{-1,0},{1,0},{0,-1},{0,1},{0,0}}; // N, S, W, E, wait
+
+    while(!open.empty()) {
+        PQNode curr = open.top();
+        open.pop();
+        size_t currKey = key(curr.coord, curr.moves);
 
-        if (c == end) {
-            return {dist,stationDensityHint};
+        if(curr.coord == end) {
+            // reconstruct path, a wait shows up as the same cell twice
+            std::vector<Pair> path;
+            for(size_t k = currKey; k != key(start,0); k = parents[k]) {
+                size_t cell = k / (horizon + 1);
+                path.push_back({cell / cols, cell % cols});
+            }
+            std::reverse(path.begin(), path.end());
+            charge();
+            return path;
         }
 
-        for (auto d : directions) {
-            int ni = (int)c.first + d.first;
-            int nj = (int)c.second + d.second;
+        if(!closed.insert(currKey).second) continue;
 
-            if (ni < 0 || nj < 0)
+        for(Pair d : directions) {
+            bool wait = d.first == 0 && d.second == 0;
+            if(wait && (curr.moves >= horizon || isDock(map[curr.coord.first][curr.coord.second])))
                 continue;
 
-            Pair next = {(size_t)ni, (size_t)nj};
+            int ni = curr.coord.first + d.first;
+            int nj = curr.coord.second + d.second;
+            Pair neighbor = {ni, nj};
 
-            if (!isValid(next, rows, cols))
+            if(!isValid(neighbor, rows, cols) || !isPassable(map, neighbor,agent))
                 continue;
 
-            if (!isPassable(map, next, agent))
+            size_t moves = std::min(curr.moves + 1, horizon);
+            if(curr.moves < horizon && !isDock(map[ni][nj]) && !reservations.isFree(neighbor, tickOf(moves), agent.getId()))
                 continue;
 
-            if (!visited[next.first][next.second]) {
-                visited[next.first][next.second] = true;
-                if(map[next.first][next.second] == Cell::STATION || map[next.first][next.second] == Cell::BASE)
-                    stationDensityHint++;
-                q.push({next, dist + 1});
+            size_t nextKey = key(neighbor, moves);
+            if(closed.count(nextKey)) continue;
+
+            int tentativeG = g[currKey] + getG(map[ni][nj],agent.getCurrentBattery(),agent.getMaxBattery());
+            auto it = g.find(nextKey);
+            if(it == g.end() || tentativeG < it->second) {
+                g[nextKey] = tentativeG;
+                open.push({neighbor, moves, tentativeG + estimate(neighbor)});
+                parents[nextKey] = currKey;
             }
         }
     }
 
-    return {-1,0};
+    charge();
+    return {};
+}
+
+std::pair<int,int> bfsDistance(const BitGrid& passable, const BitGrid& chargers, Pair start, Pair end){
+    int distance = -1;
+    BitGrid visited;
+
+    floodFill(passable, start, visited, [&](size_t step, const BitGrid& layer, size_t, size_t){
+        if(layer.test(end)){
+            distance = static_cast<int>(step);
+            return false;
+        }
+        return true;
+    });
+
+    if(distance == -1)
+        return {-1,0};
+
+    // chargers met on the way out to the destination's distance, the start itself does not count
+    int stationDensityHint = 0;
+    for(size_t r = 0; r < visited.getRows(); r++)
+        for(size_t w = 0; w < visited.getWords(); w++)
+            if(uint64_t found = visited.row(r)[w] & chargers.row(r)[w])
+                stationDensityHint += static_cast<int>(BitGrid::popcount(found));
+    if(chargers.test(start))
+        stationDensityHint--;
+
+    return {distance,stationDensityHint};
+}
+
+std::pair<int,int> bfsDistance(const CellGrid& map, Pair start, Pair end, Agent& agent){
+    return bfsDistance(BitGrid::passable(map, agent.getTerrain()), BitGrid::cellsOf(map, Cell::STATION, Cell::BASE), start, end);
+}
+
+
+int bfsDistance(const BitGrid& passable, Pair start, Pair end){
+    if(start == end)
+        return 0;
+    if(!passable.test(end))
+        return -1;
+
+    BitGrid from(passable.getRows(), passable.getCols()), to(passable.getRows(), passable.getCols());
+    from.set(start);
+    to.set(end);
+    Flood forward(passable, from), backward(passable, to);
+
+    // grow the smaller frontier; the first layer touching the other ball closes the gap at the sum of depths
+    while(true){
+        bool forwardTurn = forward.getSize() <= backward.getSize();
+        Flood& side = forwardTurn ? forward : backward;
+        const Flood& other = forwardTurn ? backward : forward;
+
+        if(!side.grow())
+            return -1;
+
+        const BitGrid& layer = side.getFrontier();
+        const BitGrid& seen = other.getVisited();
+        for(size_t r = side.getLow(); r <= side.getHigh(); r++)
+            for(size_t w = 0; w < layer.getWords(); w++)
+                if(layer.row(r)[w] & seen.row(r)[w])
+                    return static_cast<int>(forward.getDepth() + backward.getDepth());
+    }
+}
+
+std::pair<int,int> bfsDistance(const BitGrid& passable, const ChargingGraph& graph, TerrainType terrain, Pair start, Pair end){
+    int distance = terrain == TerrainType::AIR ? heuristic(start, end) : bfsDistance(passable, start, end);
+    if(distance == -1)
+        return {-1,0};
+    return {distance, graph.chargersWithin(start, distance, terrain)};
 }
\ No newline at end of file
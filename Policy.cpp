@@ -0,0 +1,40 @@
+#include "policy.h"
+
+Policy Policy::current;
+
+// costs stay at 1 or above, the search heuristic counts every step as 1
+const std::vector<Policy::Field>& Policy::fields(){
+    static const std::vector<Field> all = {
+        {"DIST_WEIGHT:",         &Policy::distWeight,        1, 40},
+        {"STATION_WEIGHT:",      &Policy::stationWeight,     0, 40},
+        {"ROAD_COST:",           &Policy::roadCost,          1, 30},
+        {"CLIENT_COST:",         &Policy::clientCost,        1, 30},
+        {"STATION_HIGH_COST:",   &Policy::stationHighCost,   1, 100},
+        {"STATION_LOW_COST:",    &Policy::stationLowCost,    1, 30},
+        {"LOW_BATTERY_PERCENT:", &Policy::lowBatteryPercent, 5, 60},
+        {"RECHARGE_PERCENT:",    &Policy::rechargePercent,   5, 60},
+    };
+    return all;
+}
+
+bool Policy::read(const std::string& label, std::istream& value){
+    for(const Field& field : fields())
+        if(label == field.label){
+            value >> this->*field.value;
+            return true;
+        }
+    return false;
+}
+
+bool Policy::isDefault() const{
+    const Policy defaults;
+    for(const Field& field : fields())
+        if(this->*field.value != defaults.*field.value)
+            return false;
+    return true;
+}
+
+void Policy::write(std::FILE* file) const{
+    for(const Field& field : fields())
+        std::fprintf(file,"%s %d\n",field.label,this->*field.value);
+}
@@ -0,0 +1,108 @@
+#include "reservationtable.h"
+
+constexpr uint64_t EMPTY_SLOT = ~0ull;
+constexpr uint64_t FREED_SLOT = ~0ull - 1;
+
+static size_t slotFor(uint32_t cell, size_t mask){
+    return (cell * 0x9E3779B1u) & mask;
+}
+
+void ReservationTable::configure(size_t _window, size_t _cols){
+    window = _window > 0 ? _window : 1;
+    cols = _cols;
+    buckets.assign(window, Bucket());
+    owned.clear();
+    memory.resize(0);
+}
+
+void ReservationTable::advance(size_t tick){
+    now = tick;
+}
+
+const ReservationTable::Bucket* ReservationTable::liveBucket(size_t tick) const{
+    if(buckets.empty() || tick < now || tick >= now + window)
+        return nullptr;
+    const Bucket& bucket = buckets[tick % window];
+    return bucket.tick == tick ? &bucket : nullptr;
+}
+
+ReservationTable::Bucket& ReservationTable::writableBucket(size_t tick){
+    Bucket& bucket = buckets[tick % window];
+    size_t before = bytesOf(bucket.slots);
+    if(bucket.tick != tick){
+        bucket.tick = tick;
+        bucket.used = 0;
+        bucket.slots.assign(bucket.slots.empty() ? 64 : bucket.slots.size(), EMPTY_SLOT);
+    }
+
+    // keep the load under one half, tombstones included
+    if((bucket.used + 1) * 2 > bucket.slots.size()){
+        std::vector<uint64_t> old;
+        old.swap(bucket.slots);
+        bucket.slots.assign(old.size() * 2, EMPTY_SLOT);
+        bucket.used = 0;
+        size_t mask = bucket.slots.size() - 1;
+        for(uint64_t entry : old){
+            if(entry == EMPTY_SLOT || entry == FREED_SLOT)
+                continue;
+            size_t i = slotFor(uint32_t(entry >> 32), mask);
+            while(bucket.slots[i] != EMPTY_SLOT)
+                i = (i + 1) & mask;
+            bucket.slots[i] = entry;
+            bucket.used++;
+        }
+    }
+    memory.resize(memory.getBytes() + bytesOf(bucket.slots) - before);
+    return bucket;
+}
+
+bool ReservationTable::isFree(std::pair<size_t,size_t> cell, size_t tick, size_t agentId) const{
+    const Bucket* bucket = liveBucket(tick);
+    if(bucket == nullptr)
+        return true;
+
+    uint32_t index = uint32_t(cell.first * cols + cell.second);
+    size_t mask = bucket->slots.size() - 1;
+    for(size_t i = slotFor(index, mask); bucket->slots[i] != EMPTY_SLOT; i = (i + 1) & mask){
+        uint64_t entry = bucket->slots[i];
+        if(entry != FREED_SLOT && uint32_t(entry >> 32) == index && uint32_t(entry) != uint32_t(agentId))
+            return false;
+    }
+    return true;
+}
+
+void ReservationTable::reserve(size_t agentId, std::pair<size_t,size_t> cell, size_t tick){
+    if(buckets.empty() || tick < now || tick >= now + window)
+        return;
+
+    Bucket& bucket = writableBucket(tick);
+    uint32_t index = uint32_t(cell.first * cols + cell.second);
+    size_t mask = bucket.slots.size() - 1;
+    size_t i = slotFor(index, mask);
+    while(bucket.slots[i] != EMPTY_SLOT)
+        i = (i + 1) & mask;
+    bucket.slots[i] = (uint64_t(index) << 32) | uint32_t(agentId);
+    bucket.used++;
+
+    owned[agentId].push_back({tick, index});
+}
+
+void ReservationTable::release(size_t agentId){
+    auto it = owned.find(agentId);
+    if(it == owned.end())
+        return;
+
+    for(auto [tick, index] : it->second){
+        if(liveBucket(tick) == nullptr)
+            continue;
+        Bucket& bucket = buckets[tick % window];
+        size_t mask = bucket.slots.size() - 1;
+        uint64_t entry = (uint64_t(index) << 32) | uint32_t(agentId);
+        for(size_t i = slotFor(index, mask); bucket.slots[i] != EMPTY_SLOT; i = (i + 1) & mask)
+            if(bucket.slots[i] == entry){
+                bucket.slots[i] = FREED_SLOT;
+                break;
+            }
+    }
+    owned.erase(it);
+}
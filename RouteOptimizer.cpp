@@ -0,0 +1,108 @@
+#include "routeoptimizer.h"
+#include "hivemind.h"
+#include "pathfinding.h"
+#include "agents/agents.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+// ticks charged for a leg that cannot be walked, any order avoiding it wins
+constexpr long long UNREACHABLE_TICKS = 1000000;
+
+static int legSteps(HiveMind& hiveMind, TerrainType terrain, std::pair<size_t,size_t> from, std::pair<size_t,size_t> to){
+    if(terrain == TerrainType::AIR)
+        return std::abs((int)from.first - (int)to.first) + std::abs((int)from.second - (int)to.second);
+    int steps = hiveMind.getChargingGraph().steps(from, to, terrain);
+    return steps >= 0 ? steps : bfsDistance(hiveMind.getPassable(terrain), from, to);
+}
+
+bool optimizeDeliveryOrder(HiveMind& hiveMind, const Agent& agent, std::pair<size_t,size_t> origin, size_t startTick,
+                           std::vector<PackageHandle>& stops){
+    const size_t n = stops.size();
+    if(n < 2)
+        return false;
+    const PackageStore& store = hiveMind.getPackageStore();
+
+    // points: 0 is the origin, 1..n the clients, n + 1 the base
+    std::vector<std::pair<size_t,size_t>> points = {origin};
+    for(PackageHandle handle : stops)
+        points.push_back(store[handle].client);
+    points.push_back(hiveMind.getBaseCoords());
+
+    std::vector<std::vector<long long>> ticks(n + 2, std::vector<long long>(n + 2, 0));
+    for(size_t a = 0; a <= n; a++)
+        for(size_t b = 1; b <= n + 1; b++){
+            if(a == b)
+                continue;
+            int steps = legSteps(hiveMind, agent.getTerrain(), points[a], points[b]);
+            ticks[a][b] = steps < 0 ? UNREACHABLE_TICKS : static_cast<long long>(agent.ticksFor(steps));
+        }
+
+    // order holds points 1..n
+    auto score = [&](const std::vector<size_t>& order){
+        long long travelled = 0, late = 0;
+        size_t at = 0;
+        for(size_t k : order){
+            travelled += ticks[at][k];
+            const Package& package = store[stops[k - 1]];
+            if(static_cast<long long>(startTick) + travelled - static_cast<long long>(package.firstTick) > static_cast<long long>(package.deadline))
+                late++;
+            at = k;
+        }
+        travelled += ticks[at][n + 1];
+        return travelled * static_cast<long long>(agent.getCost()) - late * deliveredLate;
+    };
+
+    std::vector<size_t> given(n);
+    for(size_t k = 0; k < n; k++)
+        given[k] = k + 1;
+
+    // cheapest insertion, the most urgent package first
+    std::vector<size_t> urgency = given;
+    std::stable_sort(urgency.begin(), urgency.end(), [&](size_t a, size_t b){
+        const Package& first = store[stops[a - 1]];
+        const Package& second = store[stops[b - 1]];
+        return first.firstTick + first.deadline < second.firstTick + second.deadline;
+    });
+    std::vector<size_t> order;
+    for(size_t k : urgency){
+        std::vector<size_t> best;
+        long long bestScore = 0;
+        for(size_t at = 0; at <= order.size(); at++){
+            std::vector<size_t> candidate = order;
+            candidate.insert(candidate.begin() + at, k);
+            long long candidateScore = score(candidate);
+            if(best.empty() || candidateScore < bestScore){
+                best = candidate;
+                bestScore = candidateScore;
+            }
+        }
+        order = best;
+    }
+
+    // 2-opt: reverse any stretch of the tour that makes it cheaper, until none does
+    long long current = score(order);
+    for(bool improved = true; improved; ){
+        improved = false;
+        for(size_t i = 0; i + 1 < n; i++)
+            for(size_t j = i + 1; j < n; j++){
+                std::reverse(order.begin() + i, order.begin() + j + 1);
+                long long candidate = score(order);
+                if(candidate < current){
+                    current = candidate;
+                    improved = true;
+                }
+                else
+                    std::reverse(order.begin() + i, order.begin() + j + 1);
+            }
+    }
+
+    if(current >= score(given))
+        return false;
+
+    std::vector<PackageHandle> ordered;
+    for(size_t k : order)
+        ordered.push_back(stops[k - 1]);
+    stops = ordered;
+    return true;
+}
@@ -0,0 +1,82 @@
+#include "scheduler.h"
+#include "hivemind.h"
+#include "agents/agents.h"
+
+#include <algorithm>
+
+Scheduler::Scheduler(std::vector<std::unique_ptr<Agent>>& _agents):
+agents(_agents),
+wakeTick(_agents.size(), 1),
+synced(_agents.size(), 0)
+{
+    for(size_t i = 0; i < agents.size(); i++)
+        events.push({1, EventType::STEP, i});
+}
+
+void Scheduler::wake(size_t agent, size_t tick){
+    if(wakeTick[agent] == tick)
+        return;
+    wakeTick[agent] = tick;
+    events.push({tick, EventType::STEP, agent});
+}
+
+void Scheduler::sleep(size_t agent, size_t tick, const CellGrid& map, HiveMind& hiveMind){
+    Agent& current = *agents[agent];
+    // idle at base with nothing to do, only an assignment wakes it up
+    if(current.getState() == AgentState::DEAD || current.isDormant(hiveMind)){
+        wakeTick[agent] = NEVER;
+        return;
+    }
+
+    size_t skipped = current.predictableTicks(map, hiveMind);
+    EventType type = EventType::STEP;
+    if(current.getState() == AgentState::CHARGING)
+        type = EventType::CHARGE_COMPLETE;
+    else if(skipped > 0)
+        type = (!current.getPackages().empty() && current.getCurrentPath().back() == hiveMind.getPackageStore()[current.getPackages().front()].client) ? EventType::DELIVERY : EventType::ARRIVAL;
+
+    wakeTick[agent] = tick + skipped + 1;
+    events.push({wakeTick[agent], type, agent});
+}
+
+void Scheduler::retire(size_t agent){
+    wakeTick[agent] = NEVER;
+}
+
+void Scheduler::catchUp(size_t agent, size_t tick, int& profit){
+    size_t until = std::min(tick, wakeTick[agent] - 1);
+    if(until > synced[agent]){
+        agents[agent]->skipTicks(until - synced[agent], profit);
+        synced[agent] = until;
+    }
+}
+
+void Scheduler::catchUpAll(size_t tick, int& profit){
+    for(size_t i = 0; i < agents.size(); i++)
+        catchUp(i, tick, profit);
+}
+
+std::vector<size_t> Scheduler::due(size_t tick){
+    std::vector<size_t> active;
+    while(!events.empty() && events.top().tick <= tick){
+        SimEvent event = events.top();
+        events.pop();
+        if(event.tick == tick && wakeTick[event.agent] == tick)
+            active.push_back(event.agent);
+    }
+
+    // agents are ticked in fleet order, a woken agent can have two entries for the same tick
+    std::sort(active.begin(), active.end());
+    active.erase(std::unique(active.begin(), active.end()), active.end());
+    return active;
+}
+
+size_t Scheduler::nextWake(size_t tick){
+    while(!events.empty()){
+        const SimEvent& event = events.top();
+        if(event.tick > tick && wakeTick[event.agent] == event.tick)
+            return event.tick;
+        events.pop();
+    }
+    return NEVER;
+}
@@ -0,0 +1,479 @@
+#include "shardpool.h"
+#include "agents/agents.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SHARDS_SUPPORTED 1
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Flat little buffers for the messages, both ends are the same binary so plain bytes are enough
+class ByteWriter{
+    std::string bytes;
+
+    public:
+        template<typename T>
+        void put(const T& value){
+            static_assert(std::is_trivially_copyable<T>::value, "only plain values go on the wire");
+            bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+        void putCell(std::pair<size_t,size_t> cell){
+            put(cell.first);
+            put(cell.second);
+        }
+        void putString(const std::string& text){
+            put<uint64_t>(text.size());
+            bytes.append(text);
+        }
+        void putPath(const std::vector<std::pair<size_t,size_t>>& path){
+            put<uint64_t>(path.size());
+            for(auto& cell : path)
+                putCell(cell);
+        }
+        const std::string& getBytes() const { return bytes; }
+};
+
+class ByteReader{
+    const std::string& bytes;
+    size_t at = 0;
+
+    public:
+        ByteReader(const std::string& _bytes): bytes(_bytes){}
+
+        template<typename T>
+        T get(){
+            T value;
+            std::memcpy(&value, bytes.data() + at, sizeof(T));
+            at += sizeof(T);
+            return value;
+        }
+        std::pair<size_t,size_t> getCell(){
+            size_t row = get<size_t>();
+            return {row, get<size_t>()};
+        }
+        std::string getString(){
+            size_t length = get<uint64_t>();
+            std::string text = bytes.substr(at, length);
+            at += length;
+            return text;
+        }
+        std::vector<std::pair<size_t,size_t>> getPath(){
+            std::vector<std::pair<size_t,size_t>> path(get<uint64_t>());
+            for(auto& cell : path)
+                cell = getCell();
+            return path;
+        }
+};
+
+static void putPackage(ByteWriter& out, PackageHandle handle, const Package& package){
+    out.put(handle);
+    out.putCell(package.client);
+    out.put(package.reward);
+    out.put(package.deadline);
+    out.put(package.firstTick);
+    out.put(package.location);
+    out.put(package.agentId);
+}
+
+// the shard keeps a copy of the package in the slot the coordinator has it in
+static PackageHandle getPackage(ByteReader& in, PackageStore& store){
+    PackageHandle handle = in.get<PackageHandle>();
+    Package& package = store.place(handle);
+    package.client = in.getCell();
+    package.reward = in.get<size_t>();
+    package.deadline = in.get<size_t>();
+    package.firstTick = in.get<size_t>();
+    package.location = in.get<Package::Location>();
+    package.agentId = in.get<uint32_t>();
+    return handle;
+}
+
+// a paused search goes over whole, its heap in the order it is in
+static void putPlan(ByteWriter& out, const PlanState& plan){
+    out.put(plan.budget);
+    out.put(plan.searching);
+    out.put(plan.refining);
+    out.put(plan.anchorFromEnd);
+    out.put(plan.pathEpsilon);
+    out.putCell(plan.pathGoal);
+    out.put(plan.finished);
+    out.putCell(plan.finishedStart);
+    out.putCell(plan.finishedGoal);
+    out.put(plan.finishedEpsilon);
+    out.put(plan.finishedLowBattery);
+    out.putPath(plan.finishedPath);
+    out.put(plan.paused);
+    out.put(plan.refined);
+
+    const AnytimeSearch& search = plan.search;
+    out.putCell(search.start);
+    out.putCell(search.goal);
+    out.put(search.epsilon);
+    out.put(search.lowBattery);
+    out.putPath(search.path);
+    out.put<uint64_t>(search.open.size());
+    for(const AnytimeSearch::Open& node : search.open){
+        out.put(node.f);
+        out.put(node.cell);
+    }
+    out.put<uint64_t>(search.reached.size());
+    for(auto& [cell, reached] : search.reached){
+        out.put(cell);
+        out.put(reached.first);
+        out.put(reached.second);
+    }
+    out.put<uint64_t>(search.closed.size());
+    for(size_t cell : search.closed)
+        out.put(cell);
+}
+
+static void getPlan(ByteReader& in, PlanState& plan){
+    plan.budget = in.get<size_t>();
+    plan.searching = in.get<bool>();
+    plan.refining = in.get<bool>();
+    plan.anchorFromEnd = in.get<size_t>();
+    plan.pathEpsilon = in.get<double>();
+    plan.pathGoal = in.getCell();
+    plan.finished = in.get<bool>();
+    plan.finishedStart = in.getCell();
+    plan.finishedGoal = in.getCell();
+    plan.finishedEpsilon = in.get<double>();
+    plan.finishedLowBattery = in.get<bool>();
+    plan.finishedPath = in.getPath();
+    plan.paused = in.get<size_t>();
+    plan.refined = in.get<size_t>();
+
+    AnytimeSearch& search = plan.search;
+    search.clear();
+    search.start = in.getCell();
+    search.goal = in.getCell();
+    search.epsilon = in.get<double>();
+    search.lowBattery = in.get<bool>();
+    search.path = in.getPath();
+    search.open.resize(in.get<uint64_t>());
+    for(AnytimeSearch::Open& node : search.open){
+        node.f = in.get<int>();
+        node.cell = in.get<size_t>();
+    }
+    for(size_t n = in.get<uint64_t>(); n > 0; n--){
+        size_t cell = in.get<size_t>();
+        int g = in.get<int>();
+        search.reached[cell] = {g, in.get<size_t>()};
+    }
+    for(size_t n = in.get<uint64_t>(); n > 0; n--)
+        search.closed.insert(in.get<size_t>());
+}
+
+// state that changes while ticking, everything else about an agent is fixed at construction
+static void putAgent(ByteWriter& out, Agent& agent){
+    out.putCell(agent.getCoordinates());
+    out.put(agent.getState());
+    out.put(agent.getCurrentBattery());
+    out.putPath(agent.getCurrentPath());
+    out.put(agent.getLostPackages());
+
+    const RouteEstimate& route = agent.getRouteCache();
+    out.put(route.valid);
+    out.putCell(route.origin);
+    out.put(route.originBattery);
+    out.put(route.cost);
+    out.put(route.stationCount);
+    out.put(route.batteryLeft);
+    out.putCell(route.endCoords);
+
+    putPlan(out, agent.getPlan());
+
+    const RouteValidity& validity = agent.getValidity();
+    out.put(validity.failed);
+    out.putCell(validity.failedFrom);
+    out.put(validity.mapVersion);
+    out.put(validity.packagesChanged);
+    out.put(validity.batteryChecked);
+    out.put(validity.lowBattery);
+    out.put(validity.replans);
+    out.put(validity.skipped);
+}
+
+static void getAgent(ByteReader& in, Agent& agent){
+    agent.setCoordinates(in.getCell());
+    agent.setState(in.get<AgentState>());
+    agent.setCurrentBattery(in.get<size_t>());
+    agent.setCurrentPath(in.getPath());
+    agent.setLostPackages(in.get<size_t>());
+
+    RouteEstimate& route = agent.getRouteCache();
+    route.valid = in.get<bool>();
+    route.origin = in.getCell();
+    route.originBattery = in.get<size_t>();
+    route.cost = in.get<int>();
+    route.stationCount = in.get<int>();
+    route.batteryLeft = in.get<size_t>();
+    route.endCoords = in.getCell();
+
+    getPlan(in, agent.getPlan());
+
+    RouteValidity& validity = agent.getValidity();
+    validity.failed = in.get<bool>();
+    validity.failedFrom = in.getCell();
+    validity.mapVersion = in.get<size_t>();
+    validity.packagesChanged = in.get<bool>();
+    validity.batteryChecked = in.get<bool>();
+    validity.lowBattery = in.get<bool>();
+    for(size_t& replans : validity.replans)
+        replans = in.get<size_t>();
+    validity.skipped = in.get<size_t>();
+}
+
+#ifdef SHARDS_SUPPORTED
+
+static bool sendAll(int socket, const char* data, size_t size){
+    while(size > 0){
+        ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+        if(sent <= 0)
+            return false;
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+static bool receiveAll(int socket, char* data, size_t size){
+    while(size > 0){
+        ssize_t received = recv(socket, data, size, 0);
+        if(received <= 0)
+            return false;
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+static bool sendMessage(int socket, const std::string& bytes){
+    uint64_t size = bytes.size();
+    return sendAll(socket, reinterpret_cast<const char*>(&size), sizeof(size)) && sendAll(socket, bytes.data(), bytes.size());
+}
+
+static bool receiveMessage(int socket, std::string& bytes){
+    uint64_t size = 0;
+    if(!receiveAll(socket, reinterpret_cast<char*>(&size), sizeof(size)))
+        return false;
+    bytes.resize(size);
+    return receiveAll(socket, &bytes[0], size);
+}
+
+ShardPool::ShardPool(HiveMind& _hiveMind, size_t shardsN): hiveMind(_hiveMind){
+    // anything still buffered would be printed again by every child
+    std::fflush(stdout);
+    std::cout.flush();
+
+    for(size_t s = 0; s < shardsN; s++){
+        int ends[2];
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0){
+            std::cerr<<"Could not open a socket for shard " << s << ", running with " << shards.size() << " shards\n";
+            break;
+        }
+
+        pid_t pid = fork();
+        if(pid < 0){
+            close(ends[0]);
+            close(ends[1]);
+            std::cerr<<"Could not start shard " << s << ", running with " << shards.size() << " shards\n";
+            break;
+        }
+        if(pid == 0){
+            close(ends[0]);
+            for(Shard& shard : shards)
+                close(shard.socket);
+            serve(ends[1]);
+            _exit(0);
+        }
+
+        close(ends[1]);
+        shards.push_back({ends[0], static_cast<long>(pid)});
+    }
+}
+
+ShardPool::~ShardPool(){
+    // closing the socket is the stop signal
+    for(Shard& shard : shards)
+        if(shard.socket >= 0)
+            close(shard.socket);
+    for(Shard& shard : shards)
+        if(shard.pid > 0)
+            waitpid(static_cast<pid_t>(shard.pid), nullptr, 0);
+}
+
+void ShardPool::lose(size_t s){
+    if(shards[s].socket < 0)
+        return;
+    std::cerr<<"Shard " << s << " stopped answering, its region is ticked by the coordinator from now on\n";
+    close(shards[s].socket);
+    shards[s].socket = -1;
+}
+
+// the shard side: tick whatever agents the coordinator sends until it hangs up
+void ShardPool::serve(int socket){
+    const CellGrid& map = hiveMind.getMap();
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+    std::string request;
+
+    while(receiveMessage(socket, request)){
+        ByteReader in(request);
+        ByteWriter out;
+        size_t tick = in.get<uint64_t>();
+        size_t count = in.get<uint64_t>();
+        out.put<uint64_t>(count);
+
+        for(size_t n = 0; n < count; n++){
+            size_t index = in.get<uint64_t>();
+            Agent& agent = *agents[index];
+            getAgent(in, agent);
+
+            PackageStore& store = hiveMind.getPackageStore();
+            std::vector<PackageHandle> sent(in.get<uint64_t>());
+            for(PackageHandle& handle : sent)
+                handle = getPackage(in, store);
+            agent.getPackages() = sent;
+
+            TickOutput output;
+            Agent::setOutput(&output);
+            agent.tick(map,hiveMind,output.profit,tick,output.delivered,output.deadAgents,output.dropped);
+            Agent::setOutput(nullptr);
+
+            // packages go back by handle, the coordinator owns the real ones and frees the delivered slots
+            out.put<uint64_t>(index);
+            putAgent(out, agent);
+            out.put<uint64_t>(agent.getPackages().size());
+            for(PackageHandle handle : agent.getPackages()){
+                out.put(handle);
+                out.put(store[handle].location);
+                out.put(store[handle].agentId);
+            }
+            out.putString(output.log);
+            MemoryLedger::add(MemorySubsystem::LOGS, -static_cast<int64_t>(output.charged));
+            out.put(output.profit);
+            out.put(output.delivered);
+            out.put(output.deadAgents);
+            out.put(output.dropped);
+            out.put(output.droppedLines);
+            out.put<uint64_t>(output.returned.size());
+            for(PackageHandle handle : output.returned)
+                out.put(handle);
+            out.put<uint64_t>(output.released.size());
+            for(PackageHandle handle : output.released)
+                out.put(handle);
+        }
+
+        if(!sendMessage(socket, out.getBytes()))
+            return;
+    }
+}
+
+std::vector<size_t> ShardPool::tick(const std::vector<size_t>& due, const std::vector<std::vector<size_t>>& groups, size_t tick, std::vector<TickOutput>& outputs){
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+    std::vector<size_t> missed;
+
+    // every shard gets its batch before any answer is read, so they all tick at the same time
+    for(size_t s = 0; s < shards.size() && s < groups.size(); s++){
+        if(groups[s].empty() || shards[s].socket < 0)
+            continue;
+        ByteWriter out;
+        out.put<uint64_t>(tick);
+        out.put<uint64_t>(groups[s].size());
+        for(size_t k : groups[s]){
+            Agent& agent = *agents[due[k]];
+            out.put<uint64_t>(due[k]);
+            putAgent(out, agent);
+            out.put<uint64_t>(agent.getPackages().size());
+            for(PackageHandle handle : agent.getPackages())
+                putPackage(out, handle, hiveMind.getPackageStore()[handle]);
+        }
+        if(!sendMessage(shards[s].socket, out.getBytes()))
+            lose(s);
+    }
+
+    std::string reply;
+    for(size_t s = 0; s < groups.size(); s++){
+        if(groups[s].empty())
+            continue;
+        if(s >= shards.size() || shards[s].socket < 0 || !receiveMessage(shards[s].socket, reply)){
+            if(s < shards.size())
+                lose(s);
+            missed.insert(missed.end(), groups[s].begin(), groups[s].end());
+            continue;
+        }
+
+        ByteReader in(reply);
+        size_t count = in.get<uint64_t>();
+        for(size_t n = 0; n < count; n++){
+            size_t k = groups[s][n];
+            size_t index = in.get<uint64_t>();
+            Agent& agent = *agents[index];
+            getAgent(in, agent);
+
+            PackageStore& store = hiveMind.getPackageStore();
+            std::vector<PackageHandle> kept(in.get<uint64_t>());
+            for(PackageHandle& handle : kept){
+                handle = in.get<PackageHandle>();
+                store[handle].location = in.get<Package::Location>();
+                store[handle].agentId = in.get<uint32_t>();
+            }
+            agent.getPackages() = kept;
+
+            TickOutput& output = outputs[k];
+            output.log = in.getString();
+            output.charged = output.log.size();
+            MemoryLedger::add(MemorySubsystem::LOGS, output.charged);
+            output.profit = in.get<int>();
+            output.delivered = in.get<size_t>();
+            output.deadAgents = in.get<size_t>();
+            output.dropped = in.get<size_t>();
+            output.droppedLines = in.get<size_t>();
+            output.returned.resize(in.get<uint64_t>());
+            for(PackageHandle& handle : output.returned){
+                handle = in.get<PackageHandle>();
+                store[handle].location = Package::Location::BASE;
+                store[handle].agentId = 0;
+            }
+            output.released.resize(in.get<uint64_t>());
+            for(PackageHandle& handle : output.released)
+                handle = in.get<PackageHandle>();
+        }
+    }
+    return missed;
+}
+
+#else
+
+ShardPool::ShardPool(HiveMind& _hiveMind, size_t shardsN): hiveMind(_hiveMind){
+    if(shardsN > 0)
+        std::cerr<<"Shard processes need fork(), running the whole simulation in this process\n";
+}
+
+ShardPool::~ShardPool(){}
+
+void ShardPool::serve(int){}
+
+void ShardPool::lose(size_t){}
+
+std::vector<size_t> ShardPool::tick(const std::vector<size_t>&, const std::vector<std::vector<size_t>>& groups, size_t, std::vector<TickOutput>&){
+    std::vector<size_t> missed;
+    for(auto& group : groups)
+        missed.insert(missed.end(), group.begin(), group.end());
+    return missed;
+}
+
+#endif
@@ -0,0 +1,563 @@
+#include "simulation.h"
+#include "types.h"
+#include "agents/agents.h"
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+
+const double deltaTime = 0.00833; // 8.33 ms per tick (~120 FPS)
+
+Simulation::Simulation(HiveMind& _hiveMind): hiveMind(_hiveMind), workload(Workload::fromSettings(_hiveMind)){
+    size_t threads = hiveMind.getWorkerThreads();
+    size_t shards = hiveMind.getShardsN();
+    if(shards > 1){
+        if(threads > 1)
+            std::cerr<<"SHARDS and WORKER_THREADS are exclusive, using " << shards << " shard processes\n";
+        // fork() copies only the calling thread, so the shards are forked while it is the only one; the order
+        // pipe reader below and the status server in main start afterwards and never exist in a shard
+        shardPool = std::make_unique<ShardPool>(hiveMind, shards);
+        tiles.configure(hiveMind.getRowsN(), shardPool->getShards());
+    }
+    else if(threads > 1){
+        pool = std::make_unique<ThreadPool>(threads);
+        tiles.configure(hiveMind.getRowsN(), threads);
+    }
+
+    // the ring is only worth its slots when something can push into it
+    const WorkloadSettings& settings = hiveMind.getWorkload();
+    if(!settings.orderPipe.empty() || settings.model == "live")
+        orders = std::make_unique<OrderQueue>(settings.orderQueueSize);
+    if(!settings.orderPipe.empty())
+        pipe = std::make_unique<OrderPipe>(*orders, settings.orderPipe);
+
+    for(auto& agent : hiveMind.getAgents())
+        agent->chargeMemory();
+}
+
+bool Simulation::running() const{
+    // a replayed trace can hold fewer orders than TOTAL_PACKAGES
+    size_t packagesN = nextArrival() == NO_ARRIVAL && !ingesting() ? spawnedPackages : hiveMind.getPackagesN();
+    return delivered + dropped < packagesN && deadAgents < hiveMind.getAgentsN();
+}
+
+size_t Simulation::nextArrival() const{
+    return prefetched ? prefetchedTick : workload.nextArrival();
+}
+
+std::vector<Order> Simulation::takeOrders(){
+    if(!prefetched)
+        return workload.take();
+    prefetched = false;
+    return std::move(prefetchedOrders);
+}
+
+bool Simulation::spawnDue(size_t tick) const{
+    return (nextArrival() <= tick || (orders && !orders->empty())) && spawnedPackages < hiveMind.getPackagesN();
+}
+
+bool Simulation::ingesting() const{
+    return orders != nullptr;
+}
+
+// every order arriving on this tick, TOTAL_PACKAGES caps the whole run
+void Simulation::spawnPackages(size_t tick){
+    if(!spawnDue(tick))
+        return;
+    for(const Order& order : nextArrival() <= tick ? takeOrders() : std::vector<Order>()){
+        if(spawnedPackages == hiveMind.getPackagesN())
+            break;
+        hiveMind.createPackage(tick, order.client, order.reward, order.deadline);
+        spawnedPackages++;
+    }
+    ingestOrders(tick);
+}
+
+// live orders join this tick's arrivals in the order they were pushed, INGEST_BATCH at most
+void Simulation::ingestOrders(size_t tick){
+    if(!orders || orders->empty())
+        return;
+    const CellGrid& map = hiveMind.getMap();
+    std::vector<Order> arrived;
+    orders->drain(arrived, hiveMind.getWorkload().ingestBatch);
+    for(const Order& order : arrived){
+        if(spawnedPackages == hiveMind.getPackagesN() || order.client.first >= map.size() || order.client.second >= map[0].size() ||
+           map[order.client.first][order.client.second] == Cell::WALL){
+            rejectedOrders++;
+            continue;
+        }
+        hiveMind.createPackage(tick, order.client, order.reward, order.deadline);
+        spawnedPackages++;
+    }
+}
+
+size_t Simulation::nextSpawn() const{
+    if(spawnedPackages >= hiveMind.getPackagesN() || nextArrival() == NO_ARRIVAL)
+        return Scheduler::NEVER;
+    return nextArrival();
+}
+
+void Simulation::assignPackages(Scheduler& scheduler, size_t tick){
+    if(!spawnDue(tick) && hiveMind.getPackages().empty()){
+        hiveMind.clearLegs();
+        return;
+    }
+
+    // scoring reads every agent's position and battery, bring the sleeping ones up to date
+    scheduler.catchUpAll(tick - 1, profit);
+    spawnPackages(tick);
+
+    for(size_t i = 0; i < hiveMind.getPackages().size(); i++){
+        size_t agent = hiveMind.decidePackageAssignment();
+        // a new package wakes its agent on this very tick
+        if(agent < hiveMind.getAgents().size())
+            scheduler.wake(agent, tick);
+    }
+    hiveMind.clearLegs();
+}
+
+void Simulation::tickActive(Scheduler& scheduler, size_t tick){
+    const CellGrid& map = hiveMind.getMap();
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+
+    std::vector<size_t> due;
+    for(size_t i : scheduler.due(tick)){
+        if(agents[i]->getState() == AgentState::DEAD){
+            scheduler.retire(i);
+            continue;
+        }
+        scheduler.catchUp(i, tick - 1, profit);
+        due.push_back(i);
+    }
+    if(hiveMind.getPlanningBudget() > 0)
+        sharePlanningBudget(due, tick);
+
+    // with a pool the next assignment stage is prepared on it while the agents move
+    SpeculationInput next;
+    bool speculating = pool && prepareSpeculation(due, next);
+    auto tickSerially = [&](){
+        for(size_t i : due)
+            agents[i]->tick(map,hiveMind,profit,tick,delivered,deadAgents,dropped);
+    };
+
+    // reservations are shared between ground agents, cooperative routing keeps the serial order
+    if(shardPool && shardPool->getShards() > 0 && !hiveMind.getCooperativeRouting())
+        tickShards(due, tick);
+    else if(pool && !hiveMind.getCooperativeRouting() && due.size() >= 2 * tiles.getTiles())
+        tickTiles(due, tick, speculating ? &next : nullptr);
+    else if(speculating)
+        pool->parallelFor(2, [&](size_t stage){
+            if(stage == 0)
+                speculate(next);
+            else
+                tickSerially();
+        });
+    else
+        tickSerially();
+
+    if(speculating)
+        hiveMind.primeLegs(next.measured);
+
+    for(size_t i : due){
+        scheduler.markSynced(i, tick);
+        scheduler.sleep(i, tick, map, hiveMind);
+        agents[i]->chargeMemory();
+    }
+    // nothing reads the map until the next tick
+    hiveMind.pageMap();
+}
+
+// One budget for the whole fleet, split evenly between the due agents that have planning to do. The shares are
+// fixed before anyone moves, so they do not depend on which thread or shard ticks whom; the cells left over by
+// the division go round the planners from tick to tick. A share an agent does not use is not passed on.
+void Simulation::sharePlanningBudget(const std::vector<size_t>& due, size_t tick){
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+    std::vector<size_t> planners;
+    for(size_t i : due){
+        agents[i]->getPlan().budget = 0;
+        if(agents[i]->wantsPlanning())
+            planners.push_back(i);
+    }
+    if(planners.empty())
+        return;
+
+    const size_t n = planners.size();
+    const size_t share = hiveMind.getPlanningBudget() / n, extra = hiveMind.getPlanningBudget() % n;
+    for(size_t k = 0; k < n; k++)
+        agents[planners[k]]->getPlan().budget = share + ((k + n - tick % n) % n < extra ? 1 : 0);
+}
+
+// Snapshot for speculate(): what the next assignment stage will most likely score. Agents that carry packages
+// are scored from the base, the others from where they stand, so the sources are the base plus the agents that
+// will not move before then (not due now, not walking); the targets are the queued packages plus the next
+// arrival. Legs from anywhere else are measured when they are needed, so a wrong guess only costs the work.
+bool Simulation::prepareSpeculation(const std::vector<size_t>& due, SpeculationInput& next){
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+    next.prefetch = !prefetched && spawnedPackages < hiveMind.getPackagesN() && workload.nextArrival() != NO_ARRIVAL;
+    for(PackageHandle handle : hiveMind.getPackages())
+        next.targets.push_back(hiveMind.getPackageStore()[handle].client);
+    if(prefetched)
+        for(const Order& order : prefetchedOrders)
+            next.targets.push_back(order.client);
+    if(next.targets.empty() && !next.prefetch)
+        return false;
+
+    std::vector<bool> moving(agents.size(), false);
+    for(size_t i : due)
+        moving[i] = true;
+
+    next.sources.push_back({TerrainType::GROUND, hiveMind.getBaseCoords()});
+    for(size_t i = 0; i < agents.size(); i++){
+        Agent& agent = *agents[i];
+        if(agent.getTerrain() != TerrainType::GROUND || moving[i] || agent.getState() == AgentState::DEAD || agent.getState() == AgentState::MOVING)
+            continue;
+        next.sources.push_back({TerrainType::GROUND, agent.getCoordinates()});
+    }
+    return true;
+}
+
+// Runs next to the agent ticks: touches only the workload (nothing else draws from the rng) and the snapshot
+void Simulation::speculate(SpeculationInput& next){
+    if(next.prefetch){
+        prefetchedTick = workload.nextArrival();
+        prefetchedOrders = workload.take();
+        prefetched = true;
+        for(const Order& order : prefetchedOrders)
+            next.targets.push_back(order.client);
+    }
+
+    std::sort(next.sources.begin(), next.sources.end());
+    next.sources.erase(std::unique(next.sources.begin(), next.sources.end()), next.sources.end());
+    std::sort(next.targets.begin(), next.targets.end());
+    next.targets.erase(std::unique(next.targets.begin(), next.targets.end()), next.targets.end());
+
+    for(auto& [terrain, from] : next.sources)
+        for(auto& to : next.targets)
+            next.measured.push_back({terrain, from, to, hiveMind.measureLeg(terrain, from, to)});
+}
+
+void Simulation::tickTiles(const std::vector<size_t>& due, size_t tick, SpeculationInput* next){
+    const CellGrid& map = hiveMind.getMap();
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+
+    std::vector<TickOutput> outputs(due.size());
+    std::vector<std::vector<size_t>> groups = tiles.split(due, agents);
+
+    // job 0 is the speculation when there is one, it is handed out first so it overlaps all the tiles
+    size_t offset = next ? 1 : 0;
+    pool->parallelFor(groups.size() + offset, [&](size_t job){
+        if(job < offset){
+            speculate(*next);
+            return;
+        }
+        for(size_t k : groups[job - offset]){
+            TickOutput& output = outputs[k];
+            Agent::setOutput(&output);
+            agents[due[k]]->tick(map,hiveMind,output.profit,tick,output.delivered,output.deadAgents,output.dropped);
+        }
+        Agent::setOutput(nullptr);
+    });
+
+    applyOutputs(outputs);
+}
+
+void Simulation::tickShards(const std::vector<size_t>& due, size_t tick){
+    const CellGrid& map = hiveMind.getMap();
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+
+    std::vector<TickOutput> outputs(due.size());
+    std::vector<std::vector<size_t>> groups = tiles.split(due, agents);
+
+    // regions whose shard is gone are ticked here
+    for(size_t k : shardPool->tick(due, groups, tick, outputs)){
+        TickOutput& output = outputs[k];
+        Agent::setOutput(&output);
+        agents[due[k]]->tick(map,hiveMind,output.profit,tick,output.delivered,output.deadAgents,output.dropped);
+    }
+    Agent::setOutput(nullptr);
+
+    applyOutputs(outputs);
+}
+
+// merged in fleet order, so the log, the package queue and the totals match a serial tick
+void Simulation::applyOutputs(std::vector<TickOutput>& outputs){
+    for(TickOutput& output : outputs){
+        std::fputs(output.log.c_str(), stdout);
+        if(output.droppedLines > 0)
+            std::printf("... %llu log lines dropped, LOGS memory budget reached\n", output.droppedLines);
+        MemoryLedger::add(MemorySubsystem::LOGS, -static_cast<int64_t>(output.charged));
+        profit += output.profit;
+        delivered += output.delivered;
+        deadAgents += output.deadAgents;
+        dropped += output.dropped;
+        for(PackageHandle handle : output.returned)
+            hiveMind.getPackages().push_back(handle);
+        for(PackageHandle handle : output.released)
+            hiveMind.getPackageStore().release(handle);
+    }
+}
+
+void Simulation::run(){
+    Scheduler scheduler(hiveMind.getAgents());
+    size_t lastTick = 0;
+
+    for (size_t tick = 1; tick <= hiveMind.getMaxTicksN() && running(); tick++) {
+        lastTick = tick;
+        std::cout<<"Tick number "<< tick << std::endl;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        hiveMind.getReservations().advance(tick);
+
+        assignPackages(scheduler, tick);
+        tickActive(scheduler, tick);
+
+        // sleeping agents settle their charging and walking costs when they wake up
+        std::cout<<"Profit: " << profit << std::endl;
+        publishSnapshot(scheduler, tick);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        if (elapsed.count() < deltaTime) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(deltaTime - elapsed.count()));
+        }
+        else
+            lateTicks++;
+        std::cout<< std::endl;
+    }
+
+    scheduler.catchUpAll(lastTick, profit);
+    publishSnapshot(scheduler, lastTick);
+    // wall clock, so only on the console: PLANNING_BUDGET is the knob that brings this down
+    if(lateTicks > 0)
+        std::printf("Ticks over the %.2f ms frame: %llu of %llu\n", deltaTime * 1000, lateTicks, lastTick);
+}
+
+void Simulation::runEventDriven(){
+    Scheduler scheduler(hiveMind.getAgents());
+    const size_t maxTicks = hiveMind.getMaxTicksN();
+
+    size_t tick = 1, lastTick = 0;
+    while(tick <= maxTicks && running()){
+        lastTick = tick;
+        std::cout<<"Tick number "<< tick << std::endl;
+
+        hiveMind.getReservations().advance(tick);
+
+        assignPackages(scheduler, tick);
+        tickActive(scheduler, tick);
+
+        std::cout<<"Profit: " << profit << std::endl << std::endl;
+        publishSnapshot(scheduler, tick);
+
+        if(!running())
+            break;
+
+        // pending packages are scored again on every tick, otherwise jump to the next wake up or spawn
+        // live orders can arrive on any tick
+        size_t next = hiveMind.getPackages().empty() && !ingesting() ? Scheduler::NEVER : tick + 1;
+        next = std::min({next, scheduler.nextWake(tick), nextSpawn()});
+
+        if(next > maxTicks){
+            lastTick = maxTicks;
+            break;
+        }
+        tick = next;
+    }
+
+    // agents that slept through the last ticks of the run
+    scheduler.catchUpAll(lastTick, profit);
+    publishSnapshot(scheduler, lastTick);
+}
+
+// Between the ticks nothing else touches the fleet, so it is read as is; readers only ever see the copy
+void Simulation::publishSnapshot(Scheduler& scheduler, size_t tick){
+    Snapshot& snapshot = snapshots.writable();
+    snapshot.tick = tick;
+    snapshot.profit = profit;
+    snapshot.delivered = delivered;
+    snapshot.dropped = dropped;
+    snapshot.deadAgents = deadAgents;
+    snapshot.spawned = spawnedPackages;
+
+    const std::vector<PackageHandle>& waiting = hiveMind.getPackages();
+    snapshot.queued = waiting.size();
+    snapshot.oldestWait = waiting.empty() ? 0 : tick - hiveMind.getPackageStore()[waiting.front()].firstTick;
+
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+    snapshot.agents.resize(agents.size());
+    for(size_t i = 0; i < agents.size(); i++){
+        Agent& agent = *agents[i];
+        Snapshot::AgentView& view = snapshot.agents[i];
+        view.id = agent.getId();
+        view.symbol = agent.getSymbol();
+        view.state = agent.getState();
+        view.asleep = agent.getState() != AgentState::DEAD && scheduler.getWakeTick(i) > tick + 1;
+        view.coordinates = agent.getCoordinates();
+        view.battery = agent.getCurrentBattery();
+        view.maxBattery = agent.getMaxBattery();
+        view.packages = agent.getPackages().size();
+    }
+    snapshots.publish();
+}
+
+// check if the simulation ran out of ticks time
+// if positive, then reset the assigned packages
+void Simulation::returnUnpickedPackages(){
+    for(auto& agent : hiveMind.getAgents()){
+        if(agent->getState() == AgentState::DEAD)
+            continue;
+        for(size_t i = 0; i < agent->getPackages().size(); i++){
+            PackageHandle handle = agent->getPackages().at(i);
+            Package& package = hiveMind.getPackageStore()[handle];
+            if(package.location == Package::Location::BASE){
+                package.agentId = 0;
+                hiveMind.getPackages().push_back(handle);
+                agent->getPackages().erase(agent->getPackages().begin() + i);
+                i--;
+            }
+        }
+    }
+}
+
+int Simulation::finalProfit() const{
+    return profit + undelivered * static_cast<int>(hiveMind.getPackages().size());
+}
+
+void Simulation::writeResults(const char* fileName){
+    std::vector<std::unique_ptr<Agent>>& agents = hiveMind.getAgents();
+
+    std::FILE* resultFile = std::fopen(fileName,"w");
+
+    std::fprintf(resultFile,"Delivered packages: %llu\n",delivered);
+    std::printf("Delivered packages: %llu\n",delivered);
+
+    std::fprintf(resultFile,"Dropped packages: %llu\n",dropped);
+    std::printf("Dropped packages: %llu\n",dropped);
+
+    bool printDeadAgents = false;
+    bool printAliveAgents = false;
+
+    for(auto& agent : agents){
+        if(agent->getState() == AgentState::DEAD){
+            if(!printDeadAgents){
+                fprintf(resultFile,"Dead Agents:\n");
+                std::cout<<"Dead Agents:\n";
+                printDeadAgents = true;
+            }
+
+            fprintf(resultFile,"Agent#%llu (%s) at (%llu,%llu)",
+                    agent->getId(),
+                    agent->getName().c_str(),
+                    agent->getCoordinates().first,
+                    agent->getCoordinates().second);
+            std::printf("Agent#%llu (%s) at (%llu,%llu)",agent->getId(),
+                    agent->getName().c_str(),
+                    agent->getCoordinates().first,
+                    agent->getCoordinates().second);
+
+            // what it carried when it died, the packages themselves are gone
+            if(agent->getLostPackages() > 0){
+                fprintf(resultFile," has %llu undelivered packages.\n",agent->getLostPackages());
+                std::printf(" has %llu undelivered packages.\n",agent->getLostPackages());
+            }else{
+                fprintf(resultFile," has no undelivered packages.\n");
+                std::printf(" has no undelivered packages.\n");
+            }
+        }
+        else{
+            if(!printAliveAgents){
+                fprintf(resultFile,"Alive Agents:\n");
+                std::cout<<"Alive Agents:\n";
+                printAliveAgents = true;
+            }
+            fprintf(resultFile,"Agent#%llu (%s) at (%llu,%llu)",
+                    agent->getId(),
+                    agent->getName().c_str(),
+                    agent->getCoordinates().first,
+                    agent->getCoordinates().second);
+            std::printf("Agent#%llu (%s) at (%llu,%llu)",agent->getId(),
+                    agent->getName().c_str(),
+                    agent->getCoordinates().first,
+                    agent->getCoordinates().second);
+
+            if(agent->getPackages().size() > 0){
+                fprintf(resultFile," has %llu undelivered packages.\n",agent->getPackages().size());
+                std::printf(" has %llu undelivered packages.\n",agent->getPackages().size());
+            }else{
+                fprintf(resultFile," has no undelivered packages.\n");
+                std::printf(" has no undelivered packages.\n");
+            }
+        }
+    }
+
+    if(hiveMind.getPackages().size() > 0){
+        fprintf(resultFile,"Found %llu undelivered packages at the base.\n",hiveMind.getPackages().size());
+        std::printf("Found %llu undelivered packages at base.\n",hiveMind.getPackages().size());
+        profit = finalProfit();
+    }
+
+    std::fprintf(resultFile,"Final Profit: %d\n",profit);
+    std::cout<<"Profit: "<< profit << std::endl;
+
+    if(ingesting()){
+        size_t malformed = pipe ? pipe->getMalformed() : 0;
+        std::fprintf(resultFile,"Live orders: %llu accepted, %llu dropped on a full queue, %llu producer stalls, %llu rejected, %llu malformed\n",
+                     orders->getAccepted(),orders->getDropped(),orders->getStalls(),rejectedOrders,malformed);
+        std::printf("Live orders: %llu accepted, %llu dropped on a full queue, %llu producer stalls, %llu rejected, %llu malformed\n",
+                    orders->getAccepted(),orders->getDropped(),orders->getStalls(),rejectedOrders,malformed);
+    }
+
+    size_t replans[static_cast<int>(ReplanReason::COUNT)] = {}, skipped = 0;
+    for(auto& agent : hiveMind.getAgents()){
+        const RouteValidity& validity = agent->getValidity();
+        for(int r = 0; r < static_cast<int>(ReplanReason::COUNT); r++)
+            replans[r] += validity.replans[r];
+        skipped += validity.skipped;
+    }
+    std::fprintf(resultFile,"Paths planned: %llu legs, %llu retries, %llu low battery detours, %llu around taken cells, %llu on a battery regime change; %llu searches skipped\n",
+                 replans[0],replans[1],replans[2],replans[3],replans[4],skipped);
+    std::printf("Paths planned: %llu legs, %llu retries, %llu low battery detours, %llu around taken cells, %llu on a battery regime change; %llu searches skipped\n",
+                replans[0],replans[1],replans[2],replans[3],replans[4],skipped);
+
+    if(hiveMind.getPlanningBudget() > 0){
+        size_t paused = 0, refined = 0;
+        for(auto& agent : hiveMind.getAgents()){
+            paused += agent->getPlan().paused;
+            refined += agent->getPlan().refined;
+        }
+        std::fprintf(resultFile,"Planning: %llu agent ticks spent waiting for a path, %llu paths refined\n",paused,refined);
+        std::printf("Planning: %llu agent ticks spent waiting for a path, %llu paths refined\n",paused,refined);
+    }
+
+    writeMemoryReport(resultFile);
+    std::fclose(resultFile);
+}
+
+// current and peak bytes per subsystem, plus the budget when there is one
+void Simulation::writeMemoryReport(std::FILE* resultFile){
+    std::fprintf(resultFile,"Memory (KiB, current / peak):\n");
+    std::printf("Memory (KiB, current / peak):\n");
+    for(int i = 0; i < static_cast<int>(MemorySubsystem::COUNT); i++){
+        MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+        size_t current = (MemoryLedger::getCurrent(subsystem) + 1023) / 1024;
+        size_t peak = (MemoryLedger::getPeak(subsystem) + 1023) / 1024;
+        size_t budget = MemoryLedger::getBudget(subsystem) / 1024;
+        if(budget > 0){
+            std::fprintf(resultFile,"  %-12s %8llu / %8llu (budget %llu)\n",MemoryLedger::name(subsystem),current,peak,budget);
+            std::printf("  %-12s %8llu / %8llu (budget %llu)\n",MemoryLedger::name(subsystem),current,peak,budget);
+        }else{
+            std::fprintf(resultFile,"  %-12s %8llu / %8llu\n",MemoryLedger::name(subsystem),current,peak);
+            std::printf("  %-12s %8llu / %8llu\n",MemoryLedger::name(subsystem),current,peak);
+        }
+    }
+
+    const ChargingGraph& graph = hiveMind.getChargingGraph();
+    if(graph.getKeptFields() < graph.getChargersN()){
+        std::fprintf(resultFile,"Charger fields kept: %llu of %llu\n",graph.getKeptFields(),graph.getChargersN());
+        std::printf("Charger fields kept: %llu of %llu\n",graph.getKeptFields(),graph.getChargersN());
+    }
+}
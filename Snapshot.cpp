@@ -0,0 +1,127 @@
+#include "snapshot.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SOCKET_SUPPORTED 1
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// ========= SNAPSHOT =========
+std::string formatSnapshot(const Snapshot& snapshot){
+    std::string text;
+    char line[256];
+    std::snprintf(line, sizeof(line), "tick %llu profit %d delivered %llu dropped %llu dead %llu spawned %llu queued %llu oldest %llu\n",
+                  snapshot.tick, snapshot.profit, snapshot.delivered, snapshot.dropped, snapshot.deadAgents, snapshot.spawned,
+                  snapshot.queued, snapshot.oldestWait);
+    text += line;
+    for(const Snapshot::AgentView& agent : snapshot.agents){
+        std::snprintf(line, sizeof(line), "agent %llu %c %s%s (%llu,%llu) battery %llu/%llu packages %llu\n",
+                      agent.id, agent.symbol, agentStateToString.at(agent.state).c_str(), agent.asleep ? " asleep" : "",
+                      agent.coordinates.first, agent.coordinates.second, agent.battery, agent.maxBattery, agent.packages);
+        text += line;
+    }
+    return text;
+}
+
+// ========= SNAPSHOT BUFFER =========
+void SnapshotBuffer::publish(){
+    // the reader's slots are not the writer's to look at, the one just written stands in for all three
+    memory.resize(3 * (sizeof(Snapshot) + slots[back].agents.capacity() * sizeof(Snapshot::AgentView)));
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+const Snapshot& SnapshotBuffer::latest(){
+    if(middle.load(std::memory_order_acquire) & FRESH)
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+    return slots[front];
+}
+
+// ========= STATUS SERVER =========
+StatusServer::StatusServer(SnapshotBuffer& _snapshots, const std::string& _path): snapshots(_snapshots), path(_path){
+    server = std::thread(&StatusServer::serve, this);
+}
+
+StatusServer::~StatusServer(){
+    stopping = true;
+    server.join();
+}
+
+#ifdef SOCKET_SUPPORTED
+
+// a socket left behind by an earlier run is removed, anything else at the path is not ours to delete
+static bool clearSocketPath(const std::string& path){
+    struct stat info;
+    if(lstat(path.c_str(), &info) != 0)
+        return errno == ENOENT;
+    if(!S_ISSOCK(info.st_mode))
+        return false;
+    return unlink(path.c_str()) == 0;
+}
+
+void StatusServer::serve(){
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path)){
+        std::cerr<<"STATUS_SOCKET path too long: " << path << "\n";
+        return;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    if(!clearSocketPath(path)){
+        std::cerr<<"Couln't use " << path << " for the status socket: something other than a socket is there, or it cannot be removed\n";
+        return;
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 16) < 0){
+        std::cerr<<"Couln't open the status socket " << path << "\n";
+        if(listener >= 0)
+            close(listener);
+        return;
+    }
+
+    while(!stopping.load()){
+        pollfd watched = {listener, POLLIN, 0};
+        if(poll(&watched, 1, 50) <= 0)
+            continue;
+        int client = accept(listener, nullptr, nullptr);
+        if(client < 0)
+            continue;
+
+        // a slow client holds this thread only, the tick loop never waits on it; one that does not read at all
+        // is given up on, so the server can always stop
+        timeval timeout = {1, 0};
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        std::string text = formatSnapshot(snapshots.latest());
+        for(size_t sent = 0; sent < text.size(); ){
+            ssize_t wrote = send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if(wrote <= 0)
+                break;
+            sent += wrote;
+        }
+        close(client);
+        served++;
+    }
+    close(listener);
+    clearSocketPath(path);
+}
+
+#else
+
+void StatusServer::serve(){
+    std::cerr<<"STATUS_SOCKET needs Unix sockets, the snapshots are only readable in process here\n";
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "spatialpartition.h"
+#include "agents/agents.h"
+
+#include <algorithm>
+
+// a tile holding this many times its fair share of the agents triggers a re-tile
+constexpr double IMBALANCE = 1.5;
+
+void SpatialPartition::configure(size_t _rows, size_t tiles){
+    rows = _rows;
+    tiles = std::max<size_t>(1, std::min(tiles, std::max<size_t>(rows, 1)));
+    cuts.assign(tiles + 1, 0);
+    for(size_t t = 0; t <= tiles; t++)
+        cuts[t] = rows * t / tiles;
+}
+
+size_t SpatialPartition::tileOf(size_t row) const{
+    return std::upper_bound(cuts.begin() + 1, cuts.end() - 1, row) - (cuts.begin() + 1);
+}
+
+void SpatialPartition::retile(const std::vector<size_t>& agentRows){
+    const size_t tiles = getTiles();
+    std::vector<size_t> perRow(rows, 0);
+    for(size_t row : agentRows)
+        perRow[row]++;
+
+    // cut t goes to the first row with t/tiles of the agents above it
+    size_t seen = 0, t = 1;
+    for(size_t r = 0; r < rows && t < tiles; r++){
+        seen += perRow[r];
+        while(t < tiles && seen * tiles >= t * agentRows.size())
+            cuts[t++] = r + 1;
+    }
+    while(t < tiles)
+        cuts[t++] = rows;
+    retiles++;
+}
+
+std::vector<std::vector<size_t>> SpatialPartition::split(const std::vector<size_t>& due, std::vector<std::unique_ptr<Agent>>& agents){
+    const size_t tiles = getTiles();
+    std::vector<size_t> agentRows(due.size()), load(tiles, 0);
+    for(size_t k = 0; k < due.size(); k++){
+        agentRows[k] = agents[due[k]]->getCoordinates().first;
+        load[tileOf(agentRows[k])]++;
+    }
+
+    size_t heaviest = tiles ? *std::max_element(load.begin(), load.end()) : 0;
+    if(due.size() >= 2 * tiles && heaviest > IMBALANCE * due.size() / tiles)
+        retile(agentRows);
+
+    std::vector<std::vector<size_t>> groups(tiles);
+    for(size_t k = 0; k < due.size(); k++)
+        groups[tileOf(agentRows[k])].push_back(k);
+    return groups;
+}
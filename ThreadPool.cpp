@@ -0,0 +1,67 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(size_t threads){
+    for(size_t i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for(std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::work(){
+    for(size_t i = nextJob.fetch_add(1); i < jobsN; i = nextJob.fetch_add(1))
+        (*job)(i);
+}
+
+void ThreadPool::workerLoop(){
+    size_t seen = 0;
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [&]{ return stopping || generation != seen; });
+            if(stopping)
+                return;
+            seen = generation;
+        }
+
+        work();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finishedWorkers++;
+        }
+        finished.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& body){
+    if(workers.empty() || n < 2){
+        for(size_t i = 0; i < n; i++)
+            body(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        jobsN = n;
+        nextJob = 0;
+        finishedWorkers = 0;
+        generation++;
+    }
+    wakeUp.notify_all();
+
+    work();
+
+    // every worker checks in for every batch, so none can wake up late and run into the next one
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]{ return finishedWorkers == workers.size(); });
+    job = nullptr;
+}
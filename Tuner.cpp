@@ -0,0 +1,200 @@
+#include "tuner.h"
+#include "simulation.h"
+#include "genesis/IMapGenerator.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include <climits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TUNING_SUPPORTED 1
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// the share of the policies drawn at random before the search narrows around the best ones
+constexpr double EXPLORED = 1.0 / 3;
+// mutation step as a share of a field's range, from the first mutation to the last
+constexpr double WIDEST_SPREAD = 0.25;
+constexpr double NARROWEST_SPREAD = 0.03;
+// mutations start from one of this many best policies
+constexpr size_t PARENTS = 3;
+
+Tuner::Tuner(HiveMind& _hiveMind): hiveMind(_hiveMind), evaluations(_hiveMind.getTuneEvaluations()),
+scenarios(std::max<size_t>(1, _hiveMind.getTuneScenarios())), rng(static_cast<unsigned>(_hiveMind.getSeed())){
+    workers = hiveMind.getWorkerThreads() > 1 ? hiveMind.getWorkerThreads() : std::thread::hardware_concurrency();
+    workers = std::max<size_t>(1, workers);
+    // the cores go to whole simulations, each of them runs on a single thread
+    hiveMind.runSerially();
+}
+
+Policy Tuner::sample(){
+    Policy policy;
+    for(const Policy::Field& field : Policy::fields())
+        policy.*field.value = std::uniform_int_distribution<int>(field.low, field.high)(rng);
+    return policy;
+}
+
+Policy Tuner::mutate(const Policy& policy, double spread){
+    Policy mutated = policy;
+    for(const Policy::Field& field : Policy::fields()){
+        std::normal_distribution<double> step(0.0, spread * (field.high - field.low));
+        int value = static_cast<int>(std::lround(mutated.*field.value + step(rng)));
+        mutated.*field.value = std::clamp(value, field.low, field.high);
+    }
+    return mutated;
+}
+
+const Policy& Tuner::run(){
+    const size_t explored = std::max<size_t>(1, static_cast<size_t>(evaluations * EXPLORED));
+    size_t done = 0, round = 0;
+
+    while(done < evaluations){
+        std::vector<Policy> batch;
+        for(size_t k = 0; k < workers && done + k < evaluations; k++){
+            size_t index = done + k;
+            if(index == 0)
+                batch.push_back(Policy::get());     // the loaded policy is the one to beat
+            else if(index < explored || trials.empty())
+                batch.push_back(sample());
+            else{
+                double progress = static_cast<double>(index - explored) / std::max<size_t>(1, evaluations - explored);
+                double spread = WIDEST_SPREAD + (NARROWEST_SPREAD - WIDEST_SPREAD) * progress;
+                size_t parent = std::uniform_int_distribution<size_t>(0, std::min(PARENTS, trials.size()) - 1)(rng);
+                batch.push_back(mutate(trials[parent].policy, spread));
+            }
+        }
+
+        std::vector<double> profits = evaluate(batch);
+        if(profits.empty())
+            break;
+        for(size_t k = 0; k < batch.size(); k++)
+            trials.push_back({batch[k], profits[k]});
+        // stable, so a tie keeps the policy tried first
+        std::stable_sort(trials.begin(), trials.end(), [](const Trial& a, const Trial& b){ return a.profit > b.profit; });
+
+        done += batch.size();
+        round++;
+        std::printf("Tuning round %llu: %llu of %llu policies, best mean profit %.1f\n",round,done,evaluations,trials.front().profit);
+    }
+
+    if(!trials.empty())
+        Policy::set(trials.front().policy);
+    return Policy::get();
+}
+
+void Tuner::writeResults(const char* fileName){
+    std::FILE* resultFile = std::fopen(fileName,"w");
+    if(trials.empty()){
+        std::fprintf(resultFile,"No policy was evaluated\n");
+        std::fclose(resultFile);
+        return;
+    }
+
+    std::fprintf(resultFile,"Best policy, mean profit %.1f over %llu scenarios from seed %llu:\n",trials.front().profit,scenarios,hiveMind.getSeed());
+    std::printf("Best policy, mean profit %.1f over %llu scenarios from seed %llu:\n",trials.front().profit,scenarios,hiveMind.getSeed());
+    trials.front().policy.write(resultFile);
+    trials.front().policy.write(stdout);
+
+    std::fprintf(resultFile,"\nEvery policy tried, best first:\n");
+    for(const Trial& trial : trials){
+        std::fprintf(resultFile,"%10.1f ",trial.profit);
+        for(const Policy::Field& field : Policy::fields())
+            std::fprintf(resultFile," %d",trial.policy.*field.value);
+        std::fprintf(resultFile,"\n");
+    }
+    std::fclose(resultFile);
+}
+
+#ifdef TUNING_SUPPORTED
+
+int Tuner::simulate(const Policy& policy, size_t scenario){
+    Policy::set(policy);
+    hiveMind.getRng().seed(static_cast<unsigned>(hiveMind.getSeed() + scenario));
+
+    // every child would write the same map file at once
+    MapGenerator generator(hiveMind.getMapFile().empty() ? static_cast<IMapGenerator*>(new ProceduralMapGenerator(hiveMind, false))
+                                                         : new FileMapLoader(hiveMind));
+    generator.runStrategy();
+
+    Simulation simulation(hiveMind);
+    simulation.runEventDriven();
+    simulation.returnUnpickedPackages();
+    return simulation.finalProfit();
+}
+
+std::vector<double> Tuner::evaluate(const std::vector<Policy>& batch){
+    struct Job{
+        long pid;
+        int pipe;
+    };
+
+    std::vector<double> profits(batch.size(), 0);
+    const size_t jobs = batch.size() * scenarios;
+    // nothing buffered gets written twice by the children
+    std::fflush(nullptr);
+    std::cout.flush();
+
+    for(size_t first = 0; first < jobs; first += workers){
+        std::vector<Job> running;
+        for(size_t job = first; job < std::min(jobs, first + workers); job++){
+            int ends[2];
+            if(pipe(ends) != 0){
+                running.push_back({-1, -1});
+                continue;
+            }
+            pid_t pid = fork();
+            if(pid == 0){
+                close(ends[0]);
+                // headless: the tick log of every run goes nowhere
+                int sink = open("/dev/null", O_WRONLY);
+                if(sink >= 0)
+                    dup2(sink, STDOUT_FILENO);
+                int profit = simulate(batch[job / scenarios], job % scenarios);
+                ssize_t written = write(ends[1], &profit, sizeof(profit));
+                _exit(written == sizeof(profit) ? 0 : 1);
+            }
+            close(ends[1]);
+            if(pid < 0){
+                close(ends[0]);
+                running.push_back({-1, -1});
+                continue;
+            }
+            running.push_back({pid, ends[0]});
+        }
+
+        for(size_t k = 0; k < running.size(); k++){
+            size_t job = first + k;
+            int profit = 0;
+            bool finished = false;
+            if(running[k].pid > 0){
+                finished = read(running[k].pipe, &profit, sizeof(profit)) == sizeof(profit);
+                close(running[k].pipe);
+                waitpid(static_cast<pid_t>(running[k].pid), nullptr, 0);
+            }
+            // a run that never finished ranks below every run that did
+            if(!finished){
+                std::cerr<<"Tuning run " << job << " failed\n";
+                profit = INT_MIN / static_cast<int>(scenarios);
+            }
+            profits[job / scenarios] += static_cast<double>(profit) / scenarios;
+        }
+    }
+    return profits;
+}
+
+#else
+
+int Tuner::simulate(const Policy&, size_t){ return 0; }
+
+std::vector<double> Tuner::evaluate(const std::vector<Policy>&){
+    std::cerr<<"Tuning needs fork(), keeping the loaded policy\n";
+    return {};
+}
+
+#endif
@@ -2,11 +2,46 @@
 #include "../hivemind.h"
 #include "../pathfinding.h"
 #include "../types.h"
+#include "../routeoptimizer.h"
+
+#include <cstdio>
+#include <cstdarg>
+#include <algorithm>
 
 size_t Agent::numberOfAgents = 0;
+thread_local TickOutput* Agent::output = nullptr;
+
+void Agent::printLog(const char* format, ...){
+    va_list args;
+    va_start(args, format);
+    if(output == nullptr){
+        std::vprintf(format, args);
+        va_end(args);
+        return;
+    }
+
+    va_list copy;
+    va_copy(copy, args);
+    int length = std::vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+    // past the LOGS budget the line is only counted, applyOutputs says how many went missing
+    if(length > 0 && !MemoryLedger::fits(MemorySubsystem::LOGS, length)){
+        output->droppedLines++;
+        length = 0;
+    }
+    if(length > 0){
+        size_t end = output->log.size();
+        output->log.resize(end + length + 1);
+        std::vsnprintf(&output->log[end], length + 1, format, args);
+        output->log.resize(end + length);
+        output->charged += length;
+        MemoryLedger::add(MemorySubsystem::LOGS, length);
+    }
+    va_end(args);
+}
 
 void Agent::logMessage(const std::string& message){
-    std::printf("Agent #%llu coords(%llu,%llu), state %s: %s\n",id,coordinates.first,coordinates.second,agentStateToString[state].c_str(),message.c_str());
+    printLog("Agent #%llu coords(%llu,%llu), state %s: %s\n",id,coordinates.first,coordinates.second,agentStateToString.at(state).c_str(),message.c_str());
 }
 
 Agent::Agent(char _symbol,TerrainType _terrain, size_t _speed, size_t _maxBattery, size_t _consumption, size_t _cost, size_t _capacity):
@@ -23,25 +58,66 @@ capacity(_capacity)
 
 }
 
-void Agent::takePackages(){
+void Agent::chargeMemory(){
+    agentMemory.resize(sizeof(*this) + name.capacity() + bytesOf(packages));
+    routeMemory.resize(bytesOf(currentPath) + plan.getBytes());
+}
+
+void Agent::takePackages(HiveMind& hiveMind, size_t currentTick){
+    PackageStore& store = hiveMind.getPackageStore();
     size_t packageCount = 0;
-    for(auto& package: packages){
-        if(package->location == Package::Location::BASE){
-            package->location = Package::Location::AGENT;
+    for(PackageHandle handle : packages){
+        Package& package = store[handle];
+        if(package.location == Package::Location::BASE){
+            package.location = Package::Location::AGENT;
             packageCount++;
         } 
     }
     if(packageCount > 0){
+        invalidateRouteCache();
         logMessage("");
-        std::printf("Picked %llu packages from base\n",packageCount);
+        printLog("Picked %llu packages from base\n",packageCount);
+        orderDeliveries(hiveMind, currentTick);
     }
 }
 
+// Reorders the carried packages from where the agent is headed; a leg already under way keeps its client first
+void Agent::orderDeliveries(HiveMind& hiveMind, size_t currentTick){
+    if(!hiveMind.getOptimizeRoutes() || packages.size() < 2)
+        return;
+
+    std::pair<size_t,size_t> origin = coordinates;
+    size_t startTick = currentTick;
+    auto first = packages.begin();
+    if(!currentPath.empty()){
+        origin = currentPath.back();
+        startTick += ticksFor(currentPath.size());
+        const PackageStore& store = hiveMind.getPackageStore();
+        auto pinned = std::find_if(packages.begin(), packages.end(), [&](PackageHandle handle){ return store[handle].client == origin; });
+        if(pinned != packages.end()){
+            std::rotate(packages.begin(), pinned, pinned + 1);
+            first++;
+        }
+    }
+
+    std::vector<PackageHandle> rest(first, packages.end());
+    if(optimizeDeliveryOrder(hiveMind, *this, origin, startTick, rest)){
+        std::copy(rest.begin(), rest.end(), first);
+        invalidateRouteCache();
+        logMessage("Delivery order optimized");
+    }
+}
+
+void Agent::addPackage(PackageHandle package){
+    packages.push_back(package);
+    invalidateRouteCache();
+}
+
 bool Agent::at(std::pair<size_t,size_t> _coordinates){
     return coordinates == _coordinates;
 }
 
-void Agent::tick(const std::vector<std::vector<Cell>>& map, HiveMind& hiveMind, int& profit, size_t currentTick, size_t& delivered, size_t& deadAgents, size_t& dropped){
+void Agent::tick(const CellGrid& map, HiveMind& hiveMind, int& profit, size_t currentTick, size_t& delivered, size_t& deadAgents, size_t& dropped){
     if (state == AgentState::DEAD)
         return;
 
@@ -49,27 +125,64 @@ void Agent::tick(const std::vector<std::vector<Cell>>& map, HiveMind& hiveMind,
         profit -= cost;
 
     if(coordinates == hiveMind.getBaseCoords())
-        takePackages();
+        takePackages(hiveMind, currentTick);
     
     // always charge fully whenever at a base or station
     if (state == AgentState::CHARGING && currentBattery < maxBattery) {
         currentBattery = std::min(currentBattery + static_cast<size_t>(maxBattery * 0.25),maxBattery);
         logMessage("Battery charged: ");
-        std::cout<< currentBattery<< std::endl;
+        printLog("%llu\n",currentBattery);
+        refinePath(map, hiveMind);
         return;
     }
     
     if(currentPath.empty()){
-        decideNextPath(map, hiveMind);
+        // the last search came back empty and nothing it depended on changed since
+        if(validity.failed && !validity.packagesChanged && validity.failedFrom == coordinates && validity.mapVersion == hiveMind.getMapVersion())
+            validity.skipped++;
+        else
+            decideNextPath(map, hiveMind);
+    }
+    else if(nextCellTaken(map, hiveMind)){
+        logMessage("Next cell taken, planning again");
+        currentPath.clear();
+        decideNextPath(map, hiveMind, ReplanReason::BLOCKED);
+    }
+    else if(validity.lowBattery != lowBattery(currentBattery, maxBattery)){
+        logMessage("Battery regime changed, planning again");
+        currentPath.clear();
+        decideNextPath(map, hiveMind, ReplanReason::REGIME);
     }
 
     if(state == AgentState::IDLE && !currentPath.empty()){
         profit -= cost;
     }
 
-    if(!currentPath.empty() && currentBattery * 100 < 25 * maxBattery){
-        currentPath = aStar(map,coordinates,packages.front()->client,*this);
-        logMessage("Low battery, recalculating path to client");
+    // low battery: finish the leg only if a charger is still in reach from its end, otherwise head for the
+    // nearest charger along the precomputed field when the battery gets there; with no charger in reach the
+    // leg is the only trip that can still deliver; checked once per path, see RouteValidity
+    if(!currentPath.empty() && !validity.batteryChecked && Policy::get().rechargeDue(currentBattery, maxBattery)){
+        const ChargingGraph& graph = hiveMind.getChargingGraph();
+        std::pair<size_t,size_t> destination = currentPath.back();
+        int afterwards = graph.distanceToCharger(destination, terrain);
+
+        if(!graph.isCharger(destination) && (afterwards < 0 || energyFor(currentPath.size() + afterwards) > currentBattery)){
+            std::vector<std::pair<size_t,size_t>> toCharger = graph.pathToCharger(coordinates, terrain);
+            if(!toCharger.empty() && energyFor(toCharger.size()) <= currentBattery){
+                currentPath = toCharger;
+                reservePath(hiveMind);
+                validity.count(ReplanReason::DETOUR);
+                validity.batteryChecked = true;
+                validity.lowBattery = lowBattery(currentBattery, maxBattery);
+                logMessage("Low battery, heading to the nearest charger");
+            }
+            else if(!toCharger.empty()){
+                validity.batteryChecked = true;
+                logMessage("Low battery, no charger in reach, finishing the leg");
+            }
+        }
+        else
+            validity.batteryChecked = true;
     }
 
     if (!currentPath.empty()) {
@@ -77,7 +190,7 @@ void Agent::tick(const std::vector<std::vector<Cell>>& map, HiveMind& hiveMind,
         state = AgentState::MOVING;
         currentBattery -= consumption;
         logMessage("Battery consumed: ");
-        std::cout<< currentBattery<< std::endl;
+        printLog("%llu\n",currentBattery);
 
         size_t steps = 0;
 
@@ -92,21 +205,27 @@ void Agent::tick(const std::vector<std::vector<Cell>>& map, HiveMind& hiveMind,
             if (cell == Cell::BASE || cell == Cell::STATION) {
 
                 if (cell == Cell::BASE)
-                    takePackages();
+                    takePackages(hiveMind, currentTick);
 
                 currentBattery = std::min(currentBattery + static_cast<size_t>(maxBattery * 0.25),maxBattery);
                 logMessage("Battery charged: ");
-                std::cout<< currentBattery<< std::endl;
+                printLog("%llu\n",currentBattery);
                 
                 if(currentBattery < maxBattery){
                     logMessage("stopped to charge.");
                     state = AgentState::CHARGING;
+                    // the schedule is off once the agent waits here, plan again after charging
+                    if(hiveMind.getCooperativeRouting()){
+                        hiveMind.getReservations().release(id);
+                        currentPath.clear();
+                    }
                     return;
                 }
             }
         }
 
-        tryDelivery(profit, currentTick, delivered);
+        tryDelivery(profit, currentTick, delivered, hiveMind);
+        refinePath(map, hiveMind);
     }
 
     if (currentBattery <= 0) {
@@ -118,57 +237,351 @@ void Agent::tick(const std::vector<std::vector<Cell>>& map, HiveMind& hiveMind,
     }
 }
 
-void Agent::decideNextPath(const std::vector<std::vector<Cell>>& map, HiveMind& hiveMind){   
-    if (hasPackages()) {
-        currentPath = aStar(map, coordinates, packages.front()->client, *this);
-        logMessage("Assigning path to client");
+size_t Agent::chargeTicksFrom(size_t battery) const{
+    size_t step = static_cast<size_t>(maxBattery * 0.25);
+    if(battery >= maxBattery || step == 0)
+        return 0;
+    return (maxBattery - battery + step - 1) / step;
+}
+
+size_t Agent::predictableTicks(const CellGrid& map, HiveMind& hiveMind) const{
+    // a paused search or a path still to be refined needs the budget of every tick
+    if(plan.busy())
+        return 0;
+
+    bool atBase = coordinates == hiveMind.getBaseCoords();
+    const PackageStore& store = hiveMind.getPackageStore();
+    if(atBase)
+        for(PackageHandle handle : packages)
+            if(store[handle].location == Package::Location::BASE)
+                return 0;
+
+    if(state == AgentState::CHARGING)
+        return currentBattery < maxBattery ? chargeTicksFrom(currentBattery) : 0;
+
+    if(state != AgentState::MOVING || atBase)
+        return 0;
+
+    size_t ticks = 0, battery = currentBattery, walked = 0;
+    while(true){
+        if(Policy::get().rechargeDue(battery, maxBattery) || battery < consumption)
+            break;
+        // the path is planned again on that tick
+        if(lowBattery(battery, maxBattery) != validity.lowBattery)
+            break;
+        // the tick has to end with path left, otherwise it delivers or plans the next leg
+        if(currentPath.size() - walked <= speed)
+            break;
+
+        bool charger = false;
+        for(size_t i = walked; i < walked + speed; i++){
+            Cell cell = map[currentPath[i].first][currentPath[i].second];
+            charger = charger || cell == Cell::BASE || cell == Cell::STATION;
+        }
+        if(charger)
+            break;
+
+        std::pair<size_t,size_t> stop = currentPath[walked + speed - 1];
+        if(!packages.empty() && stop == store[packages.front()].client)
+            break;
+        if(battery - consumption == 0)
+            break;
+
+        battery -= consumption;
+        walked += speed;
+        ticks++;
+    }
+    return ticks;
+}
+
+void Agent::skipTicks(size_t ticks, int& profit){
+    if(ticks == 0)
+        return;
+
+    if(state == AgentState::CHARGING){
+        currentBattery = std::min(currentBattery + ticks * static_cast<size_t>(maxBattery * 0.25), maxBattery);
+        profit -= static_cast<int>(ticks * cost);
+    }
+    else if(state == AgentState::MOVING){
+        size_t walked = ticks * speed;
+        coordinates = currentPath[walked - 1];
+        currentPath.erase(currentPath.begin(), currentPath.begin() + walked);
+        currentBattery -= ticks * consumption;
+        profit -= static_cast<int>(ticks * cost);
+    }
+}
+
+bool Agent::isDormant(HiveMind& hiveMind) const{
+    return state == AgentState::IDLE && packages.empty() && currentPath.empty()
+        && currentBattery == maxBattery && coordinates == hiveMind.getBaseCoords();
+}
+
+// Plain A*, or space-time A* against the other agents' reservations in cooperative mode
+std::vector<std::pair<size_t,size_t>> Agent::findPath(const CellGrid& map, HiveMind& hiveMind, std::pair<size_t,size_t> target){
+    if(!hiveMind.getCooperativeRouting() || terrain == TerrainType::AIR){
+        FlowFields& fields = hiveMind.getFlowFields();
+        bool low = lowBattery(currentBattery, maxBattery);
+        // under a budget a field that is not built yet would be a whole map search inside the tick
+        bool budgeted = hiveMind.getPlanningBudget() > 0 && terrain == TerrainType::GROUND;
+        if(fields.covers(map, target) && (!budgeted || fields.built(target, terrain, low)))
+            return fields.path(map, coordinates, target, terrain, low);
+        if(budgeted)
+            return plannedPath(map, hiveMind, target);
+        return aStar(map, coordinates, target, *this, &hiveMind.getLandmarks());
+    }
+
+    std::vector<std::pair<size_t,size_t>> path = aStar(map, coordinates, target, *this, hiveMind.getReservations(), &hiveMind.getLandmarks());
+    return path.empty() ? aStar(map, coordinates, target, *this, &hiveMind.getLandmarks()) : path;
+}
+
+std::vector<std::pair<size_t,size_t>> Agent::plannedPath(const CellGrid& map, HiveMind& hiveMind, std::pair<size_t,size_t> target){
+    // costs change with the regime, a search made under the other one is not the answer any more
+    bool low = lowBattery(currentBattery, maxBattery);
+    if(!plan.finished || plan.finishedStart != coordinates || plan.finishedGoal != target || plan.finishedLowBattery != low){
+        AnytimeSearch& search = plan.search;
+        if(!plan.searching || plan.refining || search.start != coordinates || search.goal != target || search.lowBattery != low){
+            startSearch(search, map, coordinates, target, hiveMind.getPlanningEpsilon(), low, &hiveMind.getLandmarks());
+            plan.searching = true;
+            plan.refining = false;
+        }
+
+        SearchStatus status = continueSearch(search, map, &hiveMind.getLandmarks(), plan.budget);
+        if(status == SearchStatus::RUNNING){
+            plan.paused++;
+            return {};
+        }
+        plan.searching = false;
+        if(status == SearchStatus::UNREACHABLE)
+            return {};
+
+        plan.finished = true;
+        plan.finishedStart = coordinates;
+        plan.finishedGoal = target;
+        plan.finishedEpsilon = search.epsilon;
+        plan.finishedLowBattery = search.lowBattery;
+        plan.finishedPath.swap(search.path);
+        search.path.clear();
+    }
+
+    plan.pathEpsilon = plan.finishedEpsilon;
+    plan.pathGoal = target;
+    return plan.finishedPath;
+}
+
+// Ticks of walking a refinement leaves the agent before the cell it starts from
+constexpr size_t REFINE_LEAD_TICKS = 8;
+
+void Agent::refinePath(const CellGrid& map, HiveMind& hiveMind){
+    if(plan.budget == 0 || currentPath.empty() || (plan.searching && !plan.refining))
+        return;
+    AnytimeSearch& search = plan.search;
+
+    if(!plan.refining){
+        // a detour to a charger replaced the planned path
+        if(currentPath.back() != plan.pathGoal)
+            plan.pathEpsilon = 1;
+        if(plan.pathEpsilon <= 1)
+            return;
+        size_t anchor = std::min(currentPath.size() - 1, speed * REFINE_LEAD_TICKS);
+        // nothing left to improve past the anchor
+        if(currentPath.size() - anchor < 3){
+            plan.pathEpsilon = 1;
+            return;
+        }
+        double epsilon = 1 + (plan.pathEpsilon - 1) / 2;
+        startSearch(search, map, currentPath[anchor], currentPath.back(), epsilon < 1.2 ? 1 : epsilon, lowBattery(currentBattery, maxBattery), &hiveMind.getLandmarks());
+        plan.anchorFromEnd = currentPath.size() - anchor;
+        plan.searching = true;
+        plan.refining = true;
+    }
+
+    SearchStatus status = continueSearch(search, map, &hiveMind.getLandmarks(), plan.budget);
+    if(status == SearchStatus::RUNNING)
+        return;
+    plan.searching = false;
+    plan.refining = false;
+
+    // the agent may have walked past the anchor or been sent elsewhere meanwhile, the next tick starts over
+    if(status != SearchStatus::FOUND || currentPath.size() < plan.anchorFromEnd || currentPath.back() != search.goal
+       || currentPath[currentPath.size() - plan.anchorFromEnd] != search.start)
+        return;
+
+    size_t anchor = currentPath.size() - plan.anchorFromEnd;
+    int walked = 0, found = 0;
+    for(size_t i = anchor + 1; i < currentPath.size(); i++)
+        walked += stepCost(map[currentPath[i].first][currentPath[i].second], search.lowBattery);
+    for(std::pair<size_t,size_t> cell : search.path)
+        found += stepCost(map[cell.first][cell.second], search.lowBattery);
+
+    plan.pathEpsilon = search.epsilon;
+    if(found < walked){
+        currentPath.resize(anchor + 1);
+        currentPath.insert(currentPath.end(), search.path.begin(), search.path.end());
+        validity.batteryChecked = false;
+        plan.refined++;
+        logMessage("Route refined");
+    }
+    search.path.clear();
+}
+
+// Path to target, or to the first charging stop when the battery cannot cover the direct path
+std::vector<std::pair<size_t,size_t>> Agent::routeTo(const CellGrid& map, HiveMind& hiveMind, std::pair<size_t,size_t> target){
+    std::vector<std::pair<size_t,size_t>> path = findPath(map, hiveMind, target);
+    if(path.empty())
+        return path;
+
+    const ChargingGraph& graph = hiveMind.getChargingGraph();
+    ChargePlan plan = graph.plan(coordinates, target, *this, currentBattery, static_cast<int>(path.size()));
+    if(!plan.feasible){
+        // charging first plans the trip again from a full battery
+        std::vector<std::pair<size_t,size_t>> toCharger = graph.pathToCharger(coordinates, terrain);
+        if(!toCharger.empty() && energyFor(toCharger.size()) <= currentBattery){
+            logMessage("Trip out of reach, charging first");
+            return toCharger;
+        }
+        // nothing to charge at on the way: a leg the battery covers still gets the package there, any other
+        // would only end with the agent dead on the road
+        if(energyFor(path.size()) < currentBattery || (graph.isCharger(target) && energyFor(path.size()) <= currentBattery))
+            return path;
+        // standing still until a station shows up costs nothing
+        state = AgentState::IDLE;
+        logMessage("Trip out of reach, waiting");
+        return {};
+    }
+    if(plan.stops.empty())
+        return path;
+
+    logMessage("Not enough battery, stopping to charge on the way");
+    return findPath(map, hiveMind, plan.stops.front());
+}
+
+// Holds the cells of currentPath for the ticks this agent will walk them
+void Agent::reservePath(HiveMind& hiveMind){
+    if(!hiveMind.getCooperativeRouting() || terrain == TerrainType::AIR)
+        return;
+
+    ReservationTable& reservations = hiveMind.getReservations();
+    reservations.release(id);
+    for(size_t i = 0; i < currentPath.size() && i / speed < reservations.getWindow(); i++)
+        reservations.reserve(id, currentPath[i], reservations.getNow() + i / speed);
+}
+
+bool Agent::nextCellTaken(const CellGrid& map, HiveMind& hiveMind) const{
+    if(!hiveMind.getCooperativeRouting() || terrain == TerrainType::AIR)
+        return false;
+    std::pair<size_t,size_t> next = currentPath.front();
+    Cell cell = map[next.first][next.second];
+    if(cell == Cell::BASE || cell == Cell::STATION)
+        return false;
+    const ReservationTable& reservations = hiveMind.getReservations();
+    return !reservations.isFree(next, reservations.getNow(), id);
+}
+
+void Agent::decideNextPath(const CellGrid& map, HiveMind& hiveMind, ReplanReason reason){   
+    // only a path from the budgeted planner is refined afterwards
+    plan.pathEpsilon = 1;
+    // a paused search goes on, it is not planned again
+    bool resuming = plan.searching && !plan.refining;
+    if (hasPackages(hiveMind)) {
+        currentPath = routeTo(map, hiveMind, hiveMind.getPackageStore()[packages.front()].client);
+        // the agent leaves the base on a full battery, a trip out of reach from here is one for another agent
+        if(currentPath.empty() && !plan.searching && at(hiveMind.getBaseCoords()))
+            returnPackages(hiveMind);
+        reservePath(hiveMind);
+        logMessage(plan.searching ? "Planning path to client" : "Assigning path to client");
     }
     else if (!at(hiveMind.getBaseCoords())) {
-        currentPath = aStar(map, coordinates, hiveMind.getBaseCoords(), *this);
-        logMessage("Assigning path to base");
+        currentPath = routeTo(map, hiveMind, hiveMind.getBaseCoords());
+        reservePath(hiveMind);
+        logMessage(plan.searching ? "Planning path to base" : "Assigning path to base");
     }
     else {
         state = (currentBattery < maxBattery) ? AgentState::CHARGING : AgentState::IDLE;
         // logMessage("No packages and inside base. No path assigned. Staying at base.");
+        return;
     }
+
+    if(!resuming)
+        validity.count(validity.failed ? ReplanReason::RETRY : reason);
+    validity.failed = currentPath.empty() && !plan.searching;
+    validity.failedFrom = coordinates;
+    validity.mapVersion = hiveMind.getMapVersion();
+    validity.packagesChanged = false;
+    validity.batteryChecked = false;
+    validity.lowBattery = lowBattery(currentBattery, maxBattery);
 }
 
-bool Agent::hasPackages(){
-    for(auto& package: packages){
-        if(package->location == Package::Location::AGENT)
+bool Agent::hasPackages(HiveMind& hiveMind){
+    const PackageStore& store = hiveMind.getPackageStore();
+    for(PackageHandle handle : packages){
+        if(store[handle].location == Package::Location::AGENT)
             return true;
     }
     return false;
 }
 
-void Agent::tryDelivery(int& profit, size_t currentTick,size_t& delivered){
+void Agent::tryDelivery(int& profit, size_t currentTick,size_t& delivered,HiveMind& hiveMind){
     if(!packages.empty()){
-        if(coordinates == packages.front()->client){
+        const Package& package = hiveMind.getPackageStore()[packages.front()];
+        if(coordinates == package.client){
             delivered++;
-            if(currentTick - packages.front()->firstTick > packages.front()->deadline){
+            if(currentTick - package.firstTick > package.deadline){
                 profit += deliveredLate; 
                 logMessage("Package arrived LATE.");
             }else logMessage("Package arrived IN TIME."); 
             // Remove the package from agent's list and set state to IDLE
-            std::printf("REWARD: %llu - %d\n",packages.front()->reward,currentTick - packages.front()->firstTick > packages.front()->deadline ? (-deliveredLate) : 0);
-            profit += packages.front()->reward;
+            printLog("REWARD: %llu - %d\n",package.reward,currentTick - package.firstTick > package.deadline ? (-deliveredLate) : 0);
+            profit += package.reward;
+            // the slot is freed between the ticks, see PackageStore
+            if(output != nullptr)
+                output->released.push_back(packages.front());
+            else
+                hiveMind.getPackageStore().release(packages.front());
             packages.erase(packages.begin()); 
+            invalidateRouteCache();
         }
     }
 }
 
 void Agent::dropPackages(int& profit,size_t& dropped,HiveMind& hiveMind){
-    for(size_t i = 0; i < packages.size(); i++){
-        auto package = packages[i];
-        if(package->location == Package::Location::AGENT){
+    PackageStore& store = hiveMind.getPackageStore();
+    for(PackageHandle handle : packages){
+        Package& package = store[handle];
+        if(package.location == Package::Location::AGENT){
             profit += undelivered;
             dropped++;
+            lostPackages++;
+            // nobody will deliver it, the slot is freed between the ticks like a delivered one
+            if(output != nullptr)
+                output->released.push_back(handle);
+            else
+                store.release(handle);
         }
-        if(package->location == Package::Location::BASE){
-            package->agentId = 0;
-            hiveMind.getPackages().push_back(package);
-            packages.erase(packages.begin() + i);
-            i--;
+        else{
+            package.agentId = 0;
+            if(output != nullptr)
+                output->returned.push_back(handle);
+            else
+                hiveMind.getPackages().push_back(handle);
         }
     }
+    packages.clear();
+    invalidateRouteCache();
+}
+
+// Hands every package back to the base queue, for an agent at the base that cannot make the trip
+void Agent::returnPackages(HiveMind& hiveMind){
+    PackageStore& store = hiveMind.getPackageStore();
+    for(PackageHandle handle : packages){
+        Package& package = store[handle];
+        package.location = Package::Location::BASE;
+        package.agentId = 0;
+        if(output != nullptr)
+            output->returned.push_back(handle);
+        else
+            hiveMind.getPackages().push_back(handle);
+    }
+    packages.clear();
+    invalidateRouteCache();
+    logMessage("Client out of reach, packages back to the base");
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "packagestore.h"
+
+void PackageStore::openSlab(){
+    PackageHandle first = static_cast<PackageHandle>(slabs.size() * SLAB);
+    slabs.push_back(std::make_unique<Package[]>(SLAB));
+    // handed out lowest first
+    for(size_t slot = SLAB; slot-- > 0; )
+        freed.push_back(first + static_cast<PackageHandle>(slot));
+    charge();
+}
+
+void PackageStore::charge(){
+    memory.resize(slabs.size() * SLAB * sizeof(Package) + bytesOf(slabs) + bytesOf(freed));
+}
+
+PackageHandle PackageStore::create(std::pair<size_t,size_t> client, size_t reward, size_t deadline, size_t firstTick){
+    if(freed.empty())
+        openSlab();
+    PackageHandle handle = freed.back();
+    freed.pop_back();
+    (*this)[handle] = Package(client, reward, deadline, firstTick);
+    live++;
+    return handle;
+}
+
+void PackageStore::release(PackageHandle handle){
+    freed.push_back(handle);
+    live--;
+}
+
+Package& PackageStore::place(PackageHandle handle){
+    while(handle >= getCapacity()){
+        slabs.push_back(std::make_unique<Package[]>(SLAB));
+        charge();
+    }
+    return (*this)[handle];
+}
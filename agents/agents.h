@@ -1,8 +1,11 @@
 #pragma once
 
 #include "../types.h"
+#include "../grid.h"
 #include "../hivemind.h"
-#include "package.h"
+#include "packagestore.h"
+#include "../memory.h"
+#include "../planner.h"
 
 #include <string>
 #include <vector>
@@ -12,6 +15,58 @@
 
 class HiveMind;
 
+// Cost of the route an agent is already committed to: every carried package in order, then back to base.
+// Valid only for the coordinates and battery it was computed from; the package set bumps it explicitly.
+struct RouteEstimate{
+    bool valid = false;
+    std::pair<size_t,size_t> origin;
+    size_t originBattery = 0;
+    int cost = 0;
+    int stationCount = 0;
+    size_t batteryLeft = 0;
+    std::pair<size_t,size_t> endCoords;
+};
+
+// Why an agent planned a path, see RouteValidity
+enum class ReplanReason{
+    LEG,            // the path ran out: next client, base or charging stop
+    RETRY,          // a path that could not be found, searched again after the packages or the map changed
+    DETOUR,         // below the recharge threshold with no charger in reach past the path's end
+    BLOCKED,        // cooperative routing: another agent holds the next cell
+    REGIME,         // the battery crossed LOW_BATTERY_PERCENT, step costs are not the ones the path was found with
+    COUNT
+};
+
+// What the current path was planned under; the agent plans again only when one of these is invalidated. A
+// search that found nothing is not repeated until the agent, its packages or the map change (passability does
+// not depend on the battery), and the low battery check runs once per path: walking a tick takes as much
+// energy off the battery as off what the rest of the path needs, so its answer only changes with the path.
+// A path is also planned again once the battery leaves the cost regime it was planned under.
+struct RouteValidity{
+    bool failed = false;
+    std::pair<size_t,size_t> failedFrom;
+    size_t mapVersion = 0;
+    bool packagesChanged = false;
+    bool batteryChecked = false;
+    bool lowBattery = false;        // the cost regime of the current path
+    size_t replans[static_cast<int>(ReplanReason::COUNT)] = {};
+    size_t skipped = 0;             // ticks a failed search was not repeated
+
+    void count(ReplanReason reason) { replans[static_cast<int>(reason)]++; }
+};
+
+// Side effects of one agent tick on state shared by the whole fleet. When agents are ticked on worker threads
+// each one writes here instead, and the caller applies the outputs in fleet order afterwards.
+struct TickOutput{
+    std::string log;
+    std::vector<PackageHandle> returned;                // packages handed back to the base queue
+    std::vector<PackageHandle> released;                // delivered packages, their slots go back to the store
+    int profit = 0;
+    size_t delivered = 0, deadAgents = 0, dropped = 0;
+    size_t charged = 0;                                 // log bytes on the LOGS ledger, released once printed
+    size_t droppedLines = 0;                            // log lines refused by the LOGS budget
+};
+
 class Agent{
     protected:
         std::string name;
@@ -23,21 +78,56 @@ class Agent{
         char symbol;
         TerrainType terrain;
         size_t speed, maxBattery,currentBattery, consumption, cost, capacity;
-        std::vector<std::shared_ptr<Package>> packages;
+        std::vector<PackageHandle> packages;
+        size_t lostPackages = 0;        // carried when the agent died, their slots are back in the store
         std::vector<std::pair<size_t,size_t>> currentPath;
+        RouteEstimate routeCache;
+        PlanState plan;
+        RouteValidity validity;
+        static thread_local TickOutput* output;
+        MemoryCharge agentMemory{MemorySubsystem::AGENTS};
+        MemoryCharge routeMemory{MemorySubsystem::ROUTES};
 
         void logMessage(const std::string& message);
+        void printLog(const char* format, ...);
+        std::vector<std::pair<size_t,size_t>> findPath(const CellGrid& map, HiveMind& hiveMind, std::pair<size_t,size_t> target);
+        // findPath under PLANNING_BUDGET, empty while the search is still paused
+        std::vector<std::pair<size_t,size_t>> plannedPath(const CellGrid& map, HiveMind& hiveMind, std::pair<size_t,size_t> target);
+        // spends what is left of the tick's budget improving currentPath
+        void refinePath(const CellGrid& map, HiveMind& hiveMind);
+        std::vector<std::pair<size_t,size_t>> routeTo(const CellGrid& map, HiveMind& hiveMind, std::pair<size_t,size_t> target);
+        void reservePath(HiveMind& hiveMind);
+        // cooperative routing: another agent holds the cell this one is about to enter
+        bool nextCellTaken(const CellGrid& map, HiveMind& hiveMind) const;
     public:
         Agent(char _symbol,TerrainType _terrain, size_t _speed, size_t _maxBattery, size_t _consumption, size_t _cost, size_t _capacity);
-        virtual void tick(const std::vector<std::vector<Cell>>& map, HiveMind& HiveMind,int& profit, size_t currentTick, size_t& delivered, size_t& deadAgents, size_t& dropped);
-        void decideNextPath(const std::vector<std::vector<Cell>>& map, HiveMind& hiveMind);
-        void tryDelivery(int& profit, size_t currentTick,size_t& delivered);
+        virtual void tick(const CellGrid& map, HiveMind& HiveMind,int& profit, size_t currentTick, size_t& delivered, size_t& deadAgents, size_t& dropped);
+        void decideNextPath(const CellGrid& map, HiveMind& hiveMind, ReplanReason reason = ReplanReason::LEG);
+        void tryDelivery(int& profit, size_t currentTick,size_t& delivered,HiveMind& hiveMind);
         void dropPackages(int& profit,size_t& dropped,HiveMind& hiveMind);
+        void returnPackages(HiveMind& hiveMind);
         virtual ~Agent(){};
 
-        void takePackages();
+        // redirects the logs and package hand-offs of the agents ticked on this thread, nullptr goes back to stdout
+        static void setOutput(TickOutput* _output) { output = _output; }
+
+        // picks up the packages waiting at base, then orders the deliveries
+        void takePackages(HiveMind& hiveMind, size_t currentTick);
+        void orderDeliveries(HiveMind& hiveMind, size_t currentTick);
+        void addPackage(PackageHandle package);
+
+        std::vector<PackageHandle>& getPackages() { return packages; }
+        size_t getLostPackages() const { return lostPackages; }
+        void setLostPackages(size_t lost) { lostPackages = lost; }
+
+        // cached committed route, see HiveMind::committedRoute; dropped when the packages change, which also lets
+        // a failed search run again
+        RouteEstimate& getRouteCache() { return routeCache; }
+        void invalidateRouteCache() { routeCache.valid = false; validity.packagesChanged = true; }
+        RouteValidity& getValidity() { return validity; }
 
-        std::vector<std::shared_ptr<Package>>& getPackages() { return packages; }
+        // budgeted planning state, see PLANNING_BUDGET
+        PlanState& getPlan() { return plan; }
 
         // Getters
         std::string getName() const { return name; }
@@ -70,7 +160,24 @@ class Agent{
 
         bool at(std::pair<size_t,size_t> _coordinates);
 
-        bool hasPackages();
+        // ticks and battery needed to cover a number of cells, ticks needed to charge back to full
+        size_t ticksFor(size_t steps) const { return (steps + speed - 1) / speed; }
+        size_t energyFor(size_t steps) const { return ticksFor(steps) * consumption; }
+        size_t chargeTicksFrom(size_t battery) const;
+
+        // Upcoming ticks that would only repeat the last one: charging in place, or walking a stretch of path
+        // with no charger, delivery, low battery or empty battery on it. They can be applied in bulk.
+        size_t predictableTicks(const CellGrid& map, HiveMind& hiveMind) const;
+        void skipTicks(size_t ticks, int& profit);
+        // idle at base, full and empty handed: ticking it changes nothing until a package is assigned
+        bool isDormant(HiveMind& hiveMind) const;
+        // a ground agent with a search to start, resume or refine on its next tick, see PLANNING_BUDGET
+        bool wantsPlanning() const { return terrain == TerrainType::GROUND && state != AgentState::DEAD && (plan.busy() || currentPath.empty()); }
+
+        bool hasPackages(HiveMind& hiveMind);
+
+        // brings the AGENTS and ROUTES ledger up to date with what this agent holds now
+        void chargeMemory();
 };
 
 class Drone: public Agent{
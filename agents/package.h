@@ -1,25 +1,29 @@
 #pragma once
 
 #include <utility>
+#include <cstdint>
+#include <cstddef>
 
+// One order on its way to a client. Packages live in the slabs of a PackageStore; what the scans read on every
+// tick (client, deadline, location, agent) comes first and the record stays at 48 bytes.
 struct Package{
     std::pair<size_t,size_t> client;
-    size_t reward;
-    size_t deadline;
-    size_t firstTick;
-    enum class Location{
+    size_t deadline = 0;
+    size_t firstTick = 0;
+    enum class Location : uint8_t{
         BASE,
         AGENT
-    }location;
-    size_t agentId = 0;
+    }location = Location::BASE;
+    uint32_t agentId = 0;
+    size_t reward = 0;
 
-    Package();
+    Package() = default;
     Package(std::pair<size_t,size_t> _client, size_t _reward, size_t _deadline, size_t _firstTick, Location _location = Location::BASE): 
     client(_client),
-    reward(_reward),
     deadline(_deadline),
     firstTick(_firstTick),
-    location(_location){};
+    location(_location),
+    reward(_reward){}
 
     // std::pair<size_t,size_t> getCoordinates() const { return coordinates; }
     // size_t getReward() const { return reward; }
@@ -31,4 +35,4 @@ struct Package{
     // void setDeadline(size_t _deadline) { deadline = _deadline; }
     // void setFirstTick(size_t _firstTick) { firstTick = _firstTick; }
 
-};
\ No newline at end of file
+};
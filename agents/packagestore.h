@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "package.h"
+#include "../memory.h"
+
+// Index of a package in its PackageStore: the slab in the high bits, the slot within it in the low ones
+typedef uint32_t PackageHandle;
+
+// Every package of the run, in slabs of SLAB records that never move once opened, so a handle and a reference
+// to its package stay valid while others are added. A delivered package gives its slot back to a free list and
+// the next package takes the most recently freed one, so a long run keeps reusing the same few slabs and
+// creating or moving a package never goes to the allocator. Not synchronised: packages are created and released
+// between the agent ticks, agents ticked on other threads or in shards hand their releases back in TickOutput.
+class PackageStore{
+    static constexpr size_t SLAB_BITS = 10;
+    static constexpr size_t SLAB = size_t(1) << SLAB_BITS;
+
+    std::vector<std::unique_ptr<Package[]>> slabs;
+    std::vector<PackageHandle> freed;
+    size_t live = 0;
+    MemoryCharge memory{MemorySubsystem::PACKAGES};
+
+    void openSlab();
+    void charge();
+
+    public:
+        PackageHandle create(std::pair<size_t,size_t> client, size_t reward, size_t deadline, size_t firstTick);
+        void release(PackageHandle handle);
+        // the slot of handle, opening slabs up to it; a shard keeps the coordinator's packages under the same handles
+        Package& place(PackageHandle handle);
+
+        Package& operator[](PackageHandle handle) { return slabs[handle >> SLAB_BITS][handle & (SLAB - 1)]; }
+        const Package& operator[](PackageHandle handle) const { return slabs[handle >> SLAB_BITS][handle & (SLAB - 1)]; }
+
+        size_t getLive() const { return live; }
+        size_t getCapacity() const { return slabs.size() * SLAB; }
+};
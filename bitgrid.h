@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "types.h"
+#include "grid.h"
+#include "memory.h"
+
+// One bit per cell, every row packed into 64-bit words so neighbours can be reached with shifts
+class BitGrid{
+    size_t rows = 0, cols = 0, words = 0;
+    std::vector<uint64_t> bits;
+
+    public:
+        BitGrid() = default;
+        BitGrid(size_t _rows, size_t _cols);
+
+        size_t getRows() const { return rows; }
+        size_t getCols() const { return cols; }
+        size_t getWords() const { return words; }
+        size_t getBytes() const { return bits.capacity() * sizeof(uint64_t); }
+
+        uint64_t* row(size_t r) { return bits.data() + r * words; }
+        const uint64_t* row(size_t r) const { return bits.data() + r * words; }
+
+        bool test(std::pair<size_t,size_t> cell) const { return (row(cell.first)[cell.second / 64] >> (cell.second % 64)) & 1; }
+        void set(std::pair<size_t,size_t> cell) { row(cell.first)[cell.second / 64] |= uint64_t(1) << (cell.second % 64); }
+        void clear();
+        size_t count() const;
+        static size_t popcount(uint64_t word);
+
+        // cells an agent of the given terrain can stand on
+        static BitGrid passable(const CellGrid& map, TerrainType terrain);
+        // cells of one of the given kinds
+        static BitGrid cellsOf(const CellGrid& map, Cell first, Cell second);
+};
+
+// Bit-parallel BFS, one layer per grow(): the whole frontier moves one cell with a handful of word
+// operations per row, and only the rows of the current frontier band are touched.
+class Flood{
+    const BitGrid* passable;
+    BitGrid visited, frontier, next;
+    std::vector<uint64_t> empty;
+    size_t low = 0, high = 0, depth = 0, size = 0;
+    MemoryCharge scratch{MemorySubsystem::PATHFINDING};
+
+    public:
+        Flood(const BitGrid& _passable, const BitGrid& sources);
+
+        // false once nothing new can be reached
+        bool grow();
+
+        size_t getDepth() const { return depth; }
+        size_t getSize() const { return size; }
+        const BitGrid& getVisited() const { return visited; }
+        // the cells reached on the last step, only rows getLow()..getHigh() are meaningful
+        const BitGrid& getFrontier() const { return frontier; }
+        size_t getLow() const { return low; }
+        size_t getHigh() const { return high; }
+};
+
+// Bit-parallel BFS from source over passable cells. Every step grows the whole frontier by one cell with a
+// handful of word operations per row. onLayer gets the step number and the cells first reached on it
+// (step 0 is the source), only rows low..high of the layer are meaningful; returning false stops the flood.
+// visited holds the explored ball afterwards.
+void floodFill(const BitGrid& passable, std::pair<size_t,size_t> source, BitGrid& visited,
+               const std::function<bool(size_t, const BitGrid&, size_t, size_t)>& onLayer);
+// same, starting from every cell of sources at once
+void floodFill(const BitGrid& passable, const BitGrid& sources, BitGrid& visited,
+               const std::function<bool(size_t, const BitGrid&, size_t, size_t)>& onLayer);
+
+// steps from source (or the nearest of sources) to every cell, -1 where unreachable
+std::vector<int> distanceField(const BitGrid& passable, std::pair<size_t,size_t> source);
+std::vector<int> distanceField(const BitGrid& passable, const BitGrid& sources);
@@ -4,9 +4,10 @@ setlocal enabledelayedexpansion
 REM Initialize SOURCES variable
 set "SOURCES="
 
-REM Loop through all .cpp files recursively and add to SOURCES
+REM Loop through all .cpp files recursively and add to SOURCES, the tests have their own mains
 for /R %%f in (*.cpp) do (
-    set "SOURCES=!SOURCES! %%f"
+    set "FILE=%%f"
+    if "!FILE:\tests\=!"=="!FILE!" set "SOURCES=!SOURCES! %%f"
 )
 
 REM Compile all sources and include headers folder
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <cstdint>
+
+#include "types.h"
+#include "grid.h"
+#include "bitgrid.h"
+#include "memory.h"
+
+class Agent;
+
+// Result of a battery constrained query: the chargers to stop at (in order) before reaching the destination
+struct ChargePlan{
+    bool feasible = false;
+    int ticks = 0;                                  // travel ticks plus ticks spent charging
+    size_t batteryLeft = 0;                         // battery when arriving at the destination
+    std::vector<std::pair<size_t,size_t>> stops;
+};
+
+// Contracted graph of the base, the stations and the clients.
+// Every charger (base or station) keeps a ground distance field over the whole map, so the leg from any
+// cell to a charger is a lookup; legs between nodes are precomputed per terrain. Air legs are Manhattan.
+// The fields are the bulk of the graph: those that would go over the CACHES budget are not kept, and the
+// legs to their charger are answered by a bidirectional flood instead.
+class ChargingGraph{
+    size_t rows = 0, cols = 0;
+    std::vector<std::pair<size_t,size_t>> nodes;        // chargers first, then clients
+    size_t chargersN = 0;
+    std::unordered_map<size_t,size_t> nodeIndex;        // cell index -> node
+    std::vector<std::vector<int>> chargerFields;        // ground steps from each charger, -1 if unreachable, empty if not kept
+    BitGrid ground;
+    std::vector<int> groundLegs;                        // nodes x nodes ground steps, -1 if unreachable
+
+    // per terrain (index = TerrainType), steps to the nearest charger and the direction of the next hop
+    std::vector<int> nearestDistance[2];
+    std::vector<uint8_t> nearestHop[2];
+    MemoryCharge memory{MemorySubsystem::CACHES};
+
+    int chargerSteps(size_t charger, std::pair<size_t,size_t> cell, TerrainType terrain) const;
+
+    public:
+        void build(const CellGrid& map);
+
+        bool isCharger(std::pair<size_t,size_t> cell) const;
+        size_t getChargersN() const { return chargersN; }
+        // chargers whose ground field fit in the CACHES budget
+        size_t getKeptFields() const;
+        const std::vector<std::pair<size_t,size_t>>& getNodes() const { return nodes; }
+
+        // steps from a cell to the closest base or station, -1 if none can be reached
+        int distanceToCharger(std::pair<size_t,size_t> cell, TerrainType terrain) const;
+        // chargers other than the cell itself at most `steps` away from it
+        int chargersWithin(std::pair<size_t,size_t> cell, int steps, TerrainType terrain) const;
+        // follows the nearest charger field downhill, no search involved
+        std::vector<std::pair<size_t,size_t>> pathToCharger(std::pair<size_t,size_t> cell, TerrainType terrain) const;
+
+        // steps between two cells when the graph knows them (a charger or two nodes), -1 otherwise
+        int steps(std::pair<size_t,size_t> from, std::pair<size_t,size_t> to, TerrainType terrain) const;
+
+        // cheapest route that never runs the battery dry and leaves enough at `to` to reach a charger from there,
+        // charging to full at every stop; directSteps < 0 asks the graph for the direct leg
+        ChargePlan plan(std::pair<size_t,size_t> from, std::pair<size_t,size_t> to, const Agent& agent, size_t battery, int directSteps = -1) const;
+};
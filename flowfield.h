@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <cstdint>
+
+#include "types.h"
+#include "grid.h"
+#include "memory.h"
+
+// Next hop towards one target from every cell, for one terrain and one cost regime
+struct FlowField{
+    std::vector<uint8_t> hops;      // N, S, W, E; NO_HOP at the target and where it cannot be reached
+};
+
+// Flow fields stand in for the searches agents repeat all run long, the trips to the base and to the clients.
+// A field is a Dijkstra from the target over the step costs aStar uses, so following it downhill gives a path
+// of the same cost, one lookup per step. The base fields (per terrain and cost regime) are built with the map
+// and kept. Client fields are built on first use and kept in an LRU cache of FLOW_FIELD_CACHE entries that
+// also gives way to the CACHES budget. A path never depends on whether its field was cached, so neither the
+// cache nor the threads sharing it change the simulation.
+// Under PLANNING_BUDGET nothing is built inside a tick: the ground fields of the clients, in map order, are
+// built with the map instead while FLOW_FIELD_CACHE and the CACHES budget leave room, and kept for the run.
+// Ground trips to the other clients are planned within the budget (see built).
+class FlowFields{
+    bool enabled = true;
+    size_t capacity = 16;
+    bool pinClients = false;
+    size_t rows = 0, cols = 0;
+    std::pair<size_t,size_t> base;
+    std::shared_ptr<const FlowField> baseFields[2][2];      // [terrain][low battery]
+
+    // key: (cell index * 2 + terrain) * 2 + low battery, front of recent is the most recently used
+    std::list<std::pair<size_t, std::shared_ptr<const FlowField>>> recent;
+    std::unordered_map<size_t, std::list<std::pair<size_t, std::shared_ptr<const FlowField>>>::iterator> cached;
+    std::mutex lock;
+    // built with the map under PLANNING_BUDGET, same keys, never evicted
+    std::unordered_map<size_t, std::shared_ptr<const FlowField>> pinned;
+    MemoryCharge memory{MemorySubsystem::CACHES};
+
+    size_t keyOf(std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery) const {
+        return ((target.first * cols + target.second) * 2 + static_cast<int>(terrain)) * 2 + lowBattery;
+    }
+
+    std::shared_ptr<const FlowField> compute(const CellGrid& map, std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery) const;
+    std::shared_ptr<const FlowField> clientField(const CellGrid& map, std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery);
+    size_t bytesOfField() const { return rows * cols * sizeof(uint8_t); }
+
+    public:
+        // FLOW_FIELDS and FLOW_FIELD_CACHE, before build; pinClients builds the client ground fields up front
+        void configure(bool _enabled, size_t _capacity, bool _pinClients = false);
+        void build(const CellGrid& map);
+
+        // targets the fields answer for: the base and the clients
+        bool covers(const CellGrid& map, std::pair<size_t,size_t> target) const;
+        // a covered target whose field is already there, so path() runs no search: the base, or a pinned client
+        bool built(std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery) const;
+        // path from `from` to a covered target, shaped like aStar's: without from, empty when unreachable
+        std::vector<std::pair<size_t,size_t>> path(const CellGrid& map, std::pair<size_t,size_t> from, std::pair<size_t,size_t> target, TerrainType terrain, bool lowBattery);
+};
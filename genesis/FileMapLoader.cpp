@@ -1,19 +1,149 @@
 #include "IMapGenerator.h"
+#include "../agents/agents.h"
 
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
 
 
-FileMapLoader::FileMapLoader(){}
+static bool parseCell(char symbol, Cell& cell){
+    for(auto& [candidate, character] : cellChar)
+        if(character == symbol){
+            cell = candidate;
+            return true;
+        }
+    return false;
+}
+
+// Cells of a chunk read straight from the map file: row r starts at rowStarts[r] and cell c sits 2 * c bytes in
+class MapFileChunks: public ChunkSource<Cell>{
+    std::string fileName;
+    std::vector<uint64_t> rowStarts;
+    size_t cols;
+
+    public:
+        MapFileChunks(const std::string& _fileName, std::vector<uint64_t> _rowStarts, size_t _cols):
+        fileName(_fileName), rowStarts(std::move(_rowStarts)), cols(_cols){}
+
+        // a stream of its own on every read: shard processes share the descriptors they inherit
+        void read(size_t row, size_t col, Cell* cells) const override {
+            std::ifstream fin(fileName, std::ios::binary);
+            size_t width = std::min(GridIndex::CHUNK, cols - col);
+            std::string line(2 * width, ' ');
+            for(size_t r = 0; r < GridIndex::CHUNK && row + r < rowStarts.size(); r++){
+                fin.seekg(static_cast<std::streamoff>(rowStarts[row + r] + 2 * col));
+                fin.read(&line[0], static_cast<std::streamsize>(2 * width - 1));
+                for(size_t c = 0; c < width; c++)
+                    parseCell(line[2 * c], cells[r * GridIndex::CHUNK + c]);
+            }
+        }
+};
+
+FileMapLoader::FileMapLoader(HiveMind& _hiveMind): hiveMind(_hiveMind){}
 
 void FileMapLoader::load(){
-    std::ifstream fin(mapFileName);
+    const std::string& fileName = hiveMind.getMapFile();
+    std::ifstream fin(fileName, std::ios::binary);
     if(!fin.is_open()){
-        std::cerr<<"Couln't open the file " << mapFileName << "\n";
+        std::cerr<<"Couln't open the file " << fileName << "\n";
+        return;
+    }
+
+    // first pass: the size, and the offset each row starts at; a row of any other width is rejected, so a
+    // chunk source can seek straight to its cells
+    std::vector<uint64_t> rowStarts;
+    size_t cols = 0;
+    std::string line;
+    for(uint64_t start = 0; std::getline(fin, line); start = static_cast<uint64_t>(fin.tellg())){
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(line.empty())
+            continue;
+        size_t width = (line.size() + 1) / 2;
+        if(rowStarts.empty())
+            cols = width;
+        if(width != cols || line.size() != 2 * cols - 1){
+            std::cerr<<"Row " << rowStarts.size() + 1 << " of " << fileName << " is not " << cols << " cells apart by spaces\n";
+            return;
+        }
+        rowStarts.push_back(start);
+        if(fin.eof())
+            break;
+    }
+    const size_t rows = rowStarts.size();
+    if(rows == 0){
+        std::cerr<<"The map in " << fileName << " is empty\n";
+        return;
+    }
+    if(rows != hiveMind.getRowsN() || cols != hiveMind.getColumnsN())
+        std::cout<< "MAP_SIZE overridden by " << fileName << ": " << rows << " " << cols << std::endl;
+    hiveMind.setMapSize(rows, cols);
+
+    CellGrid map(rows, cols, Cell::ROAD, hiveMind.getGridLayout());
+    ChunkTable<Cell>* chunks = map.getChunks();
+    if(chunks)
+        chunks->setSource(std::make_shared<MapFileChunks>(fileName, rowStarts, cols));
+
+    // second pass, a band of chunk rows at a time: a chunk of one kind of cell is stored as that cell, any
+    // other is left on disk; without chunks every cell is copied
+    const size_t band = GridIndex::CHUNK;
+    const size_t chunkCols = (cols + band - 1) / band;
+    std::vector<Cell> first(chunkCols);
+    std::vector<bool> uniform(chunkCols);
+    std::pair<size_t,size_t> base = {rows, cols};
+    std::vector<std::pair<size_t,size_t>> clients;
+
+    fin.clear();
+    for(size_t i = 0; i < rows; i++){
+        fin.seekg(static_cast<std::streamoff>(rowStarts[i]));
+        std::getline(fin, line);
+        for(size_t j = 0; j < cols; j++){
+            Cell cell;
+            if(!parseCell(line[2 * j], cell)){
+                std::cerr<<"Unknown cell '" << line[2 * j] << "' at (" << i << "," << j << ") in " << fileName << "\n";
+                return;
+            }
+            if(cell == Cell::BASE)
+                base = {i, j};
+            else if(cell == Cell::CLIENT)
+                clients.push_back({i, j});
+
+            if(!chunks){
+                map[i][j] = cell;
+                continue;
+            }
+            size_t k = j / band;
+            if(i % band == 0 && j % band == 0){
+                first[k] = cell;
+                uniform[k] = true;
+            }
+            uniform[k] = uniform[k] && cell == first[k];
+        }
+
+        if(chunks && (i % band == band - 1 || i == rows - 1))
+            for(size_t k = 0; k < chunkCols; k++){
+                size_t chunk = map.getIndex().chunkOf({i - i % band, k * band});
+                if(uniform[k])
+                    chunks->setUniform(chunk, first[k]);
+                else
+                    chunks->setPaged(chunk);
+            }
+    }
+
+    if(base.first == rows){
+        std::cerr<<"No base on the map in " << fileName << "\n";
         return;
     }
-    std::string contents(
-    (std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
-    std::cout<<contents;
-}
\ No newline at end of file
+    if(chunks)
+        std::cout<< "Map " << rows << "x" << cols << ": " << chunks->getUniform() << " of " << chunks->getCount()
+                 << " chunks uniform, the rest paged from " << fileName << std::endl;
+
+    hiveMind.setMap(std::move(map));
+    hiveMind.setBaseCoords(base);
+    for(auto& agent : hiveMind.getAgents())
+        agent->setCoordinates(base);
+    hiveMind.setClients(clients);
+}
@@ -30,10 +30,16 @@ class MapGenerator{
 // ========= STRATEGIES =========
 
 // ========= FILE MAP LOADER =========
+// Reads a map written the way ProceduralMapGenerator saves one: a line per row, cells as their characters with
+// a space between them. With GRID_LAYOUT: chunked the file is streamed once, uniform chunks keep only their
+// value and the rest are left on disk to be paged in when the simulation reaches them.
 class FileMapLoader: public IMapGenerator{
 
+    private:
+    HiveMind& hiveMind;
+
     public:
-    FileMapLoader();
+    FileMapLoader(HiveMind& _hiveMind);
     void load();
 };
 
@@ -42,10 +48,14 @@ class ProceduralMapGenerator: public IMapGenerator{
 
     private:
     HiveMind& hiveMind;
+    bool saveMap;
 
     public:
-        ProceduralMapGenerator(HiveMind& _hiveMind);
+        // without saveMap the map is not written to the map file, so runs in parallel processes leave it alone
+        ProceduralMapGenerator(HiveMind& _hiveMind, bool _saveMap = true);
         void load();
-        bool isMapValid(std::vector<std::vector<Cell>>& map);
-        
+        bool isMapValid(CellGrid& map);
+        // PLACE_STATIONS: moves the stations of a valid map to where they save the fleet the most energy
+        void placeStations(CellGrid& map);
+
 };
@@ -2,19 +2,22 @@
 #include "../types.h"
 #include "../hivemind.h"
 #include "../agents/agents.h"
+#include "../bitgrid.h"
+#include "../threadpool.h"
+#include "../memory.h"
 
 #include <iostream>
 #include <vector>
 #include <memory>
 #include <random>
 #include <algorithm>
-#include <queue>
+#include <cstdlib>
 
-ProceduralMapGenerator::ProceduralMapGenerator(HiveMind& _hiveMind): hiveMind(_hiveMind){}
+ProceduralMapGenerator::ProceduralMapGenerator(HiveMind& _hiveMind, bool _saveMap): hiveMind(_hiveMind), saveMap(_saveMap){}
 
 void ProceduralMapGenerator::load(){
 
-    std::vector<std::vector<Cell>> map;
+    CellGrid map;
     size_t iterations = 0;
     size_t rows = hiveMind.getRowsN();
     size_t cols = hiveMind.getColumnsN();
@@ -36,8 +39,7 @@ void ProceduralMapGenerator::load(){
     for(size_t i = 0; i < hiveMind.getClientsN(); i++)
     cells.push_back(Cell::CLIENT);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937& gen = hiveMind.getRng();
     std::uniform_int_distribution<int> dist(0, 1); // 0 = ROAD, 1 = WALL
 
     while(cells.size() < size_t(rows * cols)) {
@@ -46,7 +48,7 @@ void ProceduralMapGenerator::load(){
 
     std::shuffle(cells.begin(), cells.end(), gen);
     
-    map = std::vector<std::vector<Cell>>(rows, std::vector<Cell>(cols));
+    map = CellGrid(rows, cols, Cell::ROAD, hiveMind.getGridLayout());
 
     for(size_t i = 0; i < rows; i++) {
         for(size_t j = 0; j < cols; j++) {
@@ -57,6 +59,9 @@ void ProceduralMapGenerator::load(){
 
     std::cout<< "Valid on try #"<< iterations << std::endl;
 
+    if(hiveMind.getPlaceStations())
+        placeStations(map);
+
     // save map
     hiveMind.setMap(map);
 
@@ -77,7 +82,9 @@ void ProceduralMapGenerator::load(){
                     clients.push_back({i,j});
             }
     hiveMind.setClients(clients);
-    
+
+    if(!saveMap)
+        return;
     std::ofstream fout(mapFileName);
 
     if(!fout.is_open()){
@@ -96,51 +103,178 @@ void ProceduralMapGenerator::load(){
     }
 }
 
-bool ProceduralMapGenerator::isMapValid(std::vector<std::vector<Cell>>& map){
-    int rows = hiveMind.getRowsN();
-    int cols = hiveMind.getColumnsN();
+bool ProceduralMapGenerator::isMapValid(CellGrid& map){
+    size_t rows = hiveMind.getRowsN();
+    size_t cols = hiveMind.getColumnsN();
 
-    int brow = -1, bcol = -1;
-    for(int i = 0; i < rows; i++)
-        for(int j = 0; j < cols; j++)
+    std::pair<size_t,size_t> base = {rows, cols};
+    for(size_t i = 0; i < rows && base.first == rows; i++)
+        for(size_t j = 0; j < cols; j++)
             if(map[i][j] == Cell::BASE){
-                brow = i;
-                bcol = j;
-                j = cols;
-                i = rows;
+                base = {i,j};
+                break;
             }
 
-    std::vector<std::vector<bool>> visited(rows,std::vector<bool>(cols,false));
-    std::queue<std::pair<int,int>> q;
-
-    q.push({brow,bcol});
-    visited[brow][bcol] = true;
-
-    int dr[] = {-1,1,0,0};
-    int dc[] = {0,0,-1,1};
-
-    while(!q.empty()){
-        auto [row,col] = q.front();
-        q.pop();
-        
-        for(int i = 0; i < 4; ++i) {
-            int nr = row + dr[i], nc = col + dc[i];
-            if(nr >= 0 && nr < rows && nc >= 0 && nc < cols
-                && !visited[nr][nc] && map[nr][nc] != Cell::WALL) {
-                visited[nr][nc] = true;
-                q.push({nr,nc});
-            }
-        }
-    }
+    // flood the whole ground reachable from the base, then every station and client must be inside it
+    BitGrid visited;
+    floodFill(BitGrid::passable(map, TerrainType::GROUND), base, visited, [](size_t, const BitGrid&, size_t, size_t){ return true; });
 
-    for(int i = 0; i < rows; i++)
-        for(int j = 0; j< cols; j++)
-            if(
-                (map[i][j] == Cell::STATION ||
-                map[i][j] == Cell::CLIENT) &&
-                visited[i][j] == false    
-            )
+    BitGrid targets = BitGrid::cellsOf(map, Cell::STATION, Cell::CLIENT);
+    for(size_t r = 0; r < rows; r++)
+        for(size_t w = 0; w < targets.getWords(); w++)
+            if(targets.row(r)[w] & ~visited.row(r)[w])
                 return false;
 
     return true;
-}
\ No newline at end of file
+}
+
+// Mean steps from a client to the nearest charger over the ground, from one multi-source flood; the clients no
+// charger can be reached from are left out and counted in unreachable
+static double meanChargerSteps(const CellGrid& map, const std::vector<std::pair<size_t,size_t>>& clients, size_t& unreachable){
+    std::vector<int> nearest = distanceField(BitGrid::passable(map, TerrainType::GROUND), BitGrid::cellsOf(map, Cell::STATION, Cell::BASE));
+    double total = 0;
+    unreachable = 0;
+    for(auto& client : clients){
+        int steps = nearest[client.first * map[0].size() + client.second];
+        if(steps < 0)
+            unreachable++;
+        else
+            total += steps;
+    }
+    return clients.size() == unreachable ? 0 : total / (clients.size() - unreachable);
+}
+
+// Greedy k-median with swap passes over the ground cells reachable from the base. A client is served by the
+// charger (the base or a station) that is cheapest to reach, at the energy per cell the fleet spends on the
+// ground and in the air; the stations go where they bring the sum over the clients down the most. Only
+// reachable roads are candidates, so the map stays valid, and ties go to the lower cell so the result does
+// not depend on the number of threads.
+void ProceduralMapGenerator::placeStations(CellGrid& map){
+    size_t rows = map.size();
+    size_t cols = map[0].size();
+    std::pair<size_t,size_t> base;
+    std::vector<std::pair<size_t,size_t>> clients;
+    size_t stationsN = 0;
+    for(size_t i = 0; i < rows; i++)
+        for(size_t j = 0; j < cols; j++){
+            if(map[i][j] == Cell::BASE)
+                base = {i,j};
+            else if(map[i][j] == Cell::CLIENT)
+                clients.push_back({i,j});
+            else if(map[i][j] == Cell::STATION)
+                stationsN++;
+        }
+    if(stationsN == 0 || clients.empty())
+        return;
+    size_t unreachableBefore = 0, unreachableAfter = 0;
+    double before = meanChargerSteps(map, clients, unreachableBefore);
+
+    // energy per cell walked or flown, summed over the fleet
+    double groundWeight = 0, airWeight = 0;
+    for(auto& agent : hiveMind.getAgents())
+        (agent->getTerrain() == TerrainType::AIR ? airWeight : groundWeight) += double(agent->getConsumption()) / agent->getSpeed();
+
+    // a station is as passable as a road, so its cell is a candidate like any reachable road
+    BitGrid ground = BitGrid::passable(map, TerrainType::GROUND);
+    std::vector<int> fromBase = distanceField(ground, base);
+    std::vector<size_t> candidates;
+    for(size_t c = 0; c < rows * cols; c++)
+        if(fromBase[c] > 0 && (map[c / cols][c % cols] == Cell::ROAD || map[c / cols][c % cols] == Cell::STATION))
+            candidates.push_back(c);
+    if(candidates.size() < stationsN){
+        std::cerr<<"Not enough reachable roads to place the stations, keeping them where they were\n";
+        return;
+    }
+    // a distance field per client, all kept for the swap passes
+    const size_t fieldBytes = clients.size() * rows * cols * sizeof(int);
+    if(!MemoryLedger::fits(MemorySubsystem::CACHES, fieldBytes)){
+        std::cerr<<"Placing the stations needs " << fieldBytes << " bytes of CACHES, keeping them where they were\n";
+        return;
+    }
+
+    for(size_t i = 0; i < rows; i++)
+        for(size_t j = 0; j < cols; j++)
+            if(map[i][j] == Cell::STATION)
+                map[i][j] = Cell::ROAD;
+
+    ThreadPool pool(hiveMind.getWorkerThreads());
+    std::vector<std::vector<int>> steps(clients.size());
+    MemoryCharge fields(MemorySubsystem::CACHES, fieldBytes);
+    pool.parallelFor(clients.size(), [&](size_t k){ steps[k] = distanceField(ground, clients[k]); });
+
+    auto cost = [&](size_t k, size_t cell){
+        size_t i = cell / cols, j = cell % cols;
+        int flown = std::abs(int(i) - int(clients[k].first)) + std::abs(int(j) - int(clients[k].second));
+        return groundWeight * steps[k][cell] + airWeight * flown;
+    };
+
+    // total over the clients when each one also gets the candidate, given what serves it otherwise
+    std::vector<double> totals(candidates.size());
+    auto best = [&](const std::vector<double>& served, const std::vector<size_t>& placed){
+        pool.parallelFor(candidates.size(), [&](size_t x){
+            double total = 0;
+            for(size_t k = 0; k < clients.size(); k++)
+                total += std::min(served[k], cost(k, candidates[x]));
+            totals[x] = total;
+        });
+        // with more stations than the clients need, the spare ones spread out from the base and each other
+        auto spread = [&](size_t x){
+            int nearest = std::abs(int(candidates[x] / cols) - int(base.first)) + std::abs(int(candidates[x] % cols) - int(base.second));
+            for(size_t p : placed)
+                nearest = std::min(nearest, std::abs(int(candidates[x] / cols) - int(candidates[p] / cols)) + std::abs(int(candidates[x] % cols) - int(candidates[p] % cols)));
+            return nearest;
+        };
+        size_t chosen = candidates.size();
+        for(size_t x = 0; x < candidates.size(); x++){
+            if(std::find(placed.begin(), placed.end(), x) != placed.end())
+                continue;
+            if(chosen == candidates.size() || totals[x] < totals[chosen] || (totals[x] == totals[chosen] && spread(x) > spread(chosen)))
+                chosen = x;
+        }
+        return chosen;
+    };
+    auto servedWithout = [&](const std::vector<size_t>& placed, size_t skip){
+        std::vector<double> served(clients.size());
+        for(size_t k = 0; k < clients.size(); k++){
+            served[k] = cost(k, base.first * cols + base.second);
+            for(size_t s = 0; s < placed.size(); s++)
+                if(s != skip)
+                    served[k] = std::min(served[k], cost(k, candidates[placed[s]]));
+        }
+        return served;
+    };
+
+    std::vector<size_t> placed;
+    while(placed.size() < stationsN){
+        size_t chosen = best(servedWithout(placed, placed.size()), placed);
+        placed.push_back(chosen);
+    }
+
+    // move one station at a time to its best spot given the others, until a pass changes nothing
+    const size_t maxPasses = 4;
+    for(size_t pass = 0; pass < maxPasses; pass++){
+        bool moved = false;
+        for(size_t s = 0; s < placed.size(); s++){
+            std::vector<double> served = servedWithout(placed, s);
+            std::vector<size_t> others = placed;
+            others.erase(others.begin() + s);
+            size_t chosen = best(served, others);
+            double current = 0;
+            for(size_t k = 0; k < clients.size(); k++)
+                current += std::min(served[k], cost(k, candidates[placed[s]]));
+            if(totals[chosen] < current){
+                placed[s] = chosen;
+                moved = true;
+            }
+        }
+        if(!moved)
+            break;
+    }
+
+    for(size_t x : placed)
+        map[candidates[x] / cols][candidates[x] % cols] = Cell::STATION;
+    double after = meanChargerSteps(map, clients, unreachableAfter);
+    std::cout<< "Stations placed, mean steps from a client to a charger: " << before << " -> " << after << std::endl;
+    if(unreachableBefore > 0 || unreachableAfter > 0)
+        std::cout<< "Clients with no charger in reach: " << unreachableBefore << " -> " << unreachableAfter << std::endl;
+}
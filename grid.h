@@ -0,0 +1,328 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+
+#include "types.h"
+#include "memory.h"
+
+// How the cells of a grid are ordered in memory, GRID_LAYOUT: row-major | tiled | morton | chunked
+enum class GridLayout{
+    ROW_MAJOR,      // a row after the other, the vertical neighbour is a whole row away
+    TILED,          // 8x8 blocks stored one after the other, a block row by row
+    MORTON,         // Z-order: row and column bits interleaved, every aligned 2^k square is contiguous
+    CHUNKED         // 64x64 blocks kept apart: one value for a uniform block, the others paged, see ChunkTable
+};
+
+// Position of cell (row, col) in a flat array of the given layout. Tiled, chunked and Morton grids are padded, to
+// whole blocks and to power of two sides, so size() can be larger than rows * cols.
+class GridIndex{
+    static constexpr size_t TILE_BITS = 3;
+
+    GridLayout layout = GridLayout::ROW_MAJOR;
+    size_t rows = 0, cols = 0, slots = 0;
+    // tiled and chunked: side of a block in bits, blocks in a row of them
+    size_t blockBits = 0, tilesPerRow = 0;
+    // Morton: the low `shared` bits of row and column are interleaved, the rest of the longer side goes on top
+    size_t shared = 0;
+    bool tallerThanWide = false;
+
+    static size_t spread(size_t v){
+        v &= 0xFFFFFFFF;
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+        v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    }
+    static size_t compact(size_t v){
+        v &= 0x5555555555555555ull;
+        v = (v | (v >> 1)) & 0x3333333333333333ull;
+        v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v >> 4)) & 0x00FF00FF00FF00FFull;
+        v = (v | (v >> 8)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v >> 16)) & 0x00000000FFFFFFFFull;
+        return v;
+    }
+
+    public:
+        static constexpr size_t CHUNK_BITS = 6;
+        static constexpr size_t CHUNK = size_t(1) << CHUNK_BITS;
+
+        GridIndex() = default;
+        GridIndex(size_t _rows, size_t _cols, GridLayout _layout = GridLayout::ROW_MAJOR);
+
+        size_t operator()(size_t row, size_t col) const {
+            switch(layout){
+                case GridLayout::TILED:
+                case GridLayout::CHUNKED:{
+                    size_t mask = (size_t(1) << blockBits) - 1;
+                    return (((row >> blockBits) * tilesPerRow + (col >> blockBits)) << (2 * blockBits))
+                           + ((row & mask) << blockBits) + (col & mask);
+                }
+                case GridLayout::MORTON:{
+                    size_t low = (size_t(1) << shared) - 1;
+                    return (spread(row & low) << 1 | spread(col & low)) | (((row >> shared) | (col >> shared)) << (2 * shared));
+                }
+                default:
+                    return row * cols + col;
+            }
+        }
+        size_t operator()(std::pair<size_t,size_t> cell) const { return (*this)(cell.first, cell.second); }
+
+        // the cell stored at index, the inverse of operator()
+        std::pair<size_t,size_t> cell(size_t index) const;
+
+        // chunked: the chunk holding a cell, and the top left cell of a chunk
+        size_t chunkOf(std::pair<size_t,size_t> cell) const { return (*this)(cell) >> (2 * CHUNK_BITS); }
+        std::pair<size_t,size_t> chunkOrigin(size_t chunk) const { return cell(chunk << (2 * CHUNK_BITS)); }
+
+        GridLayout getLayout() const { return layout; }
+        size_t getRows() const { return rows; }
+        size_t getCols() const { return cols; }
+        // slots of a flat array in this layout, padding included
+        size_t size() const { return slots; }
+
+        static const char* name(GridLayout layout);
+        // layout from its name, false if there is none
+        static bool parse(const std::string& text, GridLayout& layout);
+};
+
+// Where the chunks of a CHUNKED grid are read back from after they were dropped
+template<typename T>
+class ChunkSource{
+    public:
+        virtual ~ChunkSource() = default;
+        // fills the chunk with top left cell (row, col) row by row, CHUNK cells to a row; cells past the edge
+        // of the grid are left alone. Called from any thread, one call at a time.
+        virtual void read(size_t row, size_t col, T* cells) const = 0;
+};
+
+// The cells of a CHUNKED grid, a chunk at a time. A chunk whose cells are all equal is only that value, open
+// road and solid rock cost nothing however large they are. Any other chunk is an array that can be paged:
+// a chunk marked paged is read from the source the first time a cell of it is read, from whatever thread, and
+// is dropped again by evict() once nothing needs it; a chunk written to stays until compact() finds it uniform.
+// Reads are lock free while the chunk is in memory, a read that misses takes the loading lock. Chunks are only
+// dropped from one thread while no other reads the grid: between the ticks, or while evictOnLoad is set (then a
+// load over the MAP budget first drops the chunk read longest ago, so only the last few reads stay valid).
+// The arrays are charged to MAP as they come and go.
+template<typename T>
+class ChunkTable{
+    struct Chunk{
+        T value{};                          // every cell while the chunk has no array
+        std::atomic<T*> cells{nullptr};
+        bool paged = false;                 // not uniform: the cells are on the source when there is no array
+        bool dirty = false;                 // written since it was read, the source is out of date
+    };
+
+    GridIndex index;
+    size_t count = 0;
+    std::unique_ptr<Chunk[]> chunks;
+    std::shared_ptr<const ChunkSource<T>> source;
+    mutable std::mutex loading;
+    mutable std::deque<size_t> readOrder;
+    mutable size_t resident = 0;
+    bool evictOnLoad = false;
+    mutable MemoryCharge memory{MemorySubsystem::MAP};
+
+    void charge() const { memory.resize(count * sizeof(Chunk) + resident * CELLS * sizeof(T)); }
+
+    void drop(size_t k) const {
+        delete[] chunks[k].cells.exchange(nullptr);
+        resident--;
+    }
+
+    T* load(size_t k) const {
+        std::lock_guard<std::mutex> lock(loading);
+        if(T* cells = chunks[k].cells.load(std::memory_order_acquire))
+            return cells;
+        while(evictOnLoad && !readOrder.empty() && !MemoryLedger::fits(MemorySubsystem::MAP, CELLS * sizeof(T))){
+            size_t oldest = readOrder.front();
+            readOrder.pop_front();
+            if(chunks[oldest].cells.load() != nullptr && !chunks[oldest].dirty)
+                drop(oldest);
+        }
+
+        T* cells = new T[CELLS];
+        std::fill(cells, cells + CELLS, chunks[k].value);
+        if(chunks[k].paged){
+            std::pair<size_t,size_t> origin = index.chunkOrigin(k);
+            source->read(origin.first, origin.second, cells);
+        }
+        chunks[k].cells.store(cells, std::memory_order_release);
+        readOrder.push_back(k);
+        resident++;
+        charge();
+        return cells;
+    }
+
+    public:
+        static constexpr size_t CELLS = GridIndex::CHUNK * GridIndex::CHUNK;
+
+        ChunkTable(const GridIndex& _index, const T& fill): index(_index), count(_index.size() / CELLS),
+        chunks(std::make_unique<Chunk[]>(count)){
+            for(size_t k = 0; k < count; k++)
+                chunks[k].value = fill;
+            charge();
+        }
+        ChunkTable(const ChunkTable& other): index(other.index), count(other.count),
+        chunks(std::make_unique<Chunk[]>(other.count)), source(other.source){
+            for(size_t k = 0; k < count; k++){
+                chunks[k].value = other.chunks[k].value;
+                chunks[k].paged = other.chunks[k].paged;
+                chunks[k].dirty = other.chunks[k].dirty;
+                if(const T* cells = other.chunks[k].cells.load()){
+                    T* copy = new T[CELLS];
+                    std::copy(cells, cells + CELLS, copy);
+                    chunks[k].cells.store(copy);
+                    readOrder.push_back(k);
+                    resident++;
+                }
+            }
+            charge();
+        }
+        ChunkTable& operator=(const ChunkTable&) = delete;
+        ~ChunkTable(){
+            for(size_t k = 0; k < count; k++)
+                delete[] chunks[k].cells.load();
+        }
+
+        const T& get(size_t i) const {
+            const Chunk& chunk = chunks[i / CELLS];
+            if(const T* cells = chunk.cells.load(std::memory_order_acquire))
+                return cells[i % CELLS];
+            if(!chunk.paged)
+                return chunk.value;
+            return load(i / CELLS)[i % CELLS];
+        }
+        // a uniform chunk gets an array before it is written to
+        T& set(size_t i){
+            size_t k = i / CELLS;
+            T* cells = chunks[k].cells.load(std::memory_order_acquire);
+            if(cells == nullptr)
+                cells = load(k);
+            chunks[k].dirty = true;
+            return cells[i % CELLS];
+        }
+
+        void setSource(std::shared_ptr<const ChunkSource<T>> _source) { source = std::move(_source); }
+        // the whole chunk is value, or it is read from the source when first needed
+        void setUniform(size_t k, const T& value){
+            if(chunks[k].cells.load() != nullptr)
+                drop(k);
+            chunks[k].value = value;
+            chunks[k].paged = chunks[k].dirty = false;
+            charge();
+        }
+        void setPaged(size_t k){
+            chunks[k].paged = source != nullptr;
+            chunks[k].dirty = false;
+        }
+        void setEvictOnLoad(bool _evictOnLoad) { evictOnLoad = _evictOnLoad; }
+
+        // uniform arrays go back to a single value
+        void compact(){
+            for(size_t k = 0; k < count; k++){
+                const T* cells = chunks[k].cells.load();
+                if(cells != nullptr && std::all_of(cells, cells + CELLS, [&](const T& cell){ return cell == cells[0]; }))
+                    setUniform(k, cells[0]);
+            }
+        }
+        // drops every clean paged chunk not marked in keep, returns how many
+        size_t evict(const std::vector<bool>& keep){
+            size_t dropped = 0;
+            for(size_t k = 0; k < count; k++)
+                if(chunks[k].paged && !chunks[k].dirty && !keep[k] && chunks[k].cells.load() != nullptr){
+                    drop(k);
+                    dropped++;
+                }
+            readOrder.erase(std::remove_if(readOrder.begin(), readOrder.end(), [&](size_t k){ return chunks[k].cells.load() == nullptr; }), readOrder.end());
+            charge();
+            return dropped;
+        }
+
+        size_t getCount() const { return count; }
+        size_t getResident() const { return resident; }
+        size_t getUniform() const {
+            size_t uniform = 0;
+            for(size_t k = 0; k < count; k++)
+                uniform += !chunks[k].paged && chunks[k].cells.load() == nullptr;
+            return uniform;
+        }
+};
+
+// A rows x cols grid stored flat in one of the layouts. map[i][j], map.size() and map[0].size() read as they
+// would on a vector of rows, so code walking the map does not care how it is laid out. A CHUNKED grid keeps its
+// cells in a ChunkTable instead of the flat array.
+template<typename T>
+class Grid{
+    GridIndex index;
+    std::vector<T> cells;
+    std::unique_ptr<ChunkTable<T>> chunks;
+
+    public:
+        class Row{
+            Grid* grid;
+            size_t row;
+
+            public:
+                Row(Grid* _grid, size_t _row): grid(_grid), row(_row){}
+                T& operator[](size_t col) const { return grid->slot(grid->index(row, col)); }
+                size_t size() const { return grid->index.getCols(); }
+        };
+        class ConstRow{
+            const Grid* grid;
+            size_t row;
+
+            public:
+                ConstRow(const Grid* _grid, size_t _row): grid(_grid), row(_row){}
+                const T& operator[](size_t col) const { return grid->slot(grid->index(row, col)); }
+                size_t size() const { return grid->index.getCols(); }
+        };
+
+        Grid() = default;
+        Grid(size_t rows, size_t cols, const T& fill = T(), GridLayout layout = GridLayout::ROW_MAJOR): index(rows, cols, layout){
+            if(layout == GridLayout::CHUNKED)
+                chunks = std::make_unique<ChunkTable<T>>(index, fill);
+            else
+                cells.assign(index.size(), fill);
+        }
+        Grid(const Grid& other): index(other.index), cells(other.cells),
+        chunks(other.chunks ? std::make_unique<ChunkTable<T>>(*other.chunks) : nullptr){}
+        Grid(Grid&&) = default;
+        Grid& operator=(const Grid& other){
+            if(this != &other)
+                *this = Grid(other);
+            return *this;
+        }
+        Grid& operator=(Grid&&) = default;
+
+        // rows, like the outer vector it replaces
+        size_t size() const { return index.getRows(); }
+        bool empty() const { return index.getRows() == 0; }
+
+        T& slot(size_t i) { return chunks ? chunks->set(i) : cells[i]; }
+        const T& slot(size_t i) const { return chunks ? chunks->get(i) : cells[i]; }
+
+        Row operator[](size_t row) { return Row(this, row); }
+        ConstRow operator[](size_t row) const { return ConstRow(this, row); }
+        T& at(std::pair<size_t,size_t> cell) { return slot(index(cell)); }
+        const T& at(std::pair<size_t,size_t> cell) const { return slot(index(cell)); }
+
+        const GridIndex& getIndex() const { return index; }
+        // nullptr unless CHUNKED
+        ChunkTable<T>* getChunks() { return chunks.get(); }
+        const ChunkTable<T>* getChunks() const { return chunks.get(); }
+        // the flat array, a chunk table charges the MAP ledger itself
+        size_t getBytes() const { return cells.capacity() * sizeof(T); }
+};
+
+typedef Grid<Cell> CellGrid;
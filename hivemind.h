@@ -5,11 +5,43 @@
 #include <memory>
 #include <utility>
 #include <random>
+#include <string>
+#include <unordered_map>
 #include "types.h"
+#include "grid.h"
 #include "agents/agents.h"
-#include "agents/package.h"
+#include "agents/packagestore.h"
+#include "charginggraph.h"
+#include "reservationtable.h"
+#include "bitgrid.h"
+#include "flowfield.h"
+#include "landmarks.h"
+#include "memory.h"
+#include "policy.h"
 
 class Agent;
+struct RouteEstimate;
+
+// How packages arrive, see workload/IWorkload.h; the defaults reproduce one package every SPAWN_FREQUENCY ticks
+struct WorkloadSettings{
+    std::string model = "fixed";    // fixed, poisson, diurnal, trace or live
+    double arrivalRate = 0;         // arrivals per tick, 0 means 1 / SPAWN_FREQUENCY
+    size_t diurnalPeriod = 1000;
+    double diurnalAmplitude = 0.8;  // the rate swings between (1 - a) and (1 + a) times arrivalRate
+    size_t burstSize = 1;           // packages per arrival
+    double clientSkew = 0;          // Zipf exponent over the clients, 0 is uniform
+    std::string traceFile;
+    std::string orderPipe;          // file or FIFO of live orders, see workload/OrderQueue.h
+    size_t orderQueueSize = 65536;  // orders waiting between producers and the tick loop
+    size_t ingestBatch = 4096;      // live orders turned into packages per tick at most
+};
+
+// One leg of an assignment estimate: {steps, chargers within that many steps of from}, see bfsDistance
+struct Leg{
+    TerrainType terrain;
+    std::pair<size_t,size_t> from, to;
+    std::pair<int,int> distance;
+};
 
 class HiveMind{
 
@@ -26,11 +58,44 @@ class HiveMind{
     spawnFreqN = 0,
     agentsN = 0;
 
-    std::vector<std::vector<Cell>> map;
+    // optional settings
+    bool cooperativeRouting = false;
+    size_t reservationWindow = 16;
+    bool eventDriven = false;
+    size_t seed = 0;
+    size_t workerThreads = 1;
+    size_t shardsN = 1;
+    WorkloadSettings workload;
+    bool flowFieldsEnabled = true;
+    size_t flowFieldCache = 16;
+    size_t landmarksN = 0;          // opt-in: the table costs 16 bytes per landmark per cell
+    bool optimizeRoutes = true;
+    size_t planningBudget = 0;      // cells the fleet may expand per tick, 0 searches every path in one go
+    double planningEpsilon = 3;     // weight of a budgeted first search, refined down to 1 afterwards
+    GridLayout gridLayout = GridLayout::ROW_MAJOR;
+    std::string mapFile;            // load this map instead of generating one
+    bool placeStations = false;     // generated maps get their stations moved near the clients
+    std::string statusSocket;       // Unix socket serving the latest snapshot, see StatusServer
+    size_t tuneEvaluations = 0;
+    size_t tuneScenarios = 1;
+
+    std::mt19937 rng;
+
+    CellGrid map;
     std::vector<std::pair<size_t,size_t>> clients;
     std::vector<std::unique_ptr<Agent>> agents;
-    std::vector<std::shared_ptr<Package>> packages;
+    PackageStore packageStore;
+    std::vector<PackageHandle> packages;     // waiting at the base, oldest first
+    ChargingGraph chargingGraph;
+    FlowFields flowFields;
+    Landmarks landmarks;
+    BitGrid groundCells, airCells, chargerCells;
+    ReservationTable reservations;
     size_t baseRow, baseCol;
+    // legs measured during the current assignment stage, keyed by legKey
+    std::unordered_map<size_t, std::pair<int,int>> legs;
+    MemoryCharge mapMemory{MemorySubsystem::MAP};
+    size_t mapVersion = 0;          // bumped by every setMap, paths planned on an older map are stale
 
     public:
         HiveMind();
@@ -47,29 +112,74 @@ class HiveMind{
         size_t getPackagesN() const { return packagesN; }
         size_t getSpawnFreqN() const { return spawnFreqN; }
         size_t getAgentsN() const { return agentsN; }
-
-        std::vector<std::shared_ptr<Package>>& getPackages() { return packages; }
-
-        const std::vector<std::vector<Cell>>& getMap(){ return map; }
+        bool getCooperativeRouting() const { return cooperativeRouting; }
+        bool getEventDriven() const { return eventDriven; }
+        size_t getWorkerThreads() const { return workerThreads; }
+        size_t getShardsN() const { return shardsN; }
+        size_t getSeed() const { return seed; }
+        GridLayout getGridLayout() const { return gridLayout; }
+        const std::string& getMapFile() const { return mapFile; }
+        bool getPlaceStations() const { return placeStations; }
+        const std::string& getStatusSocket() const { return statusSocket; }
+        size_t getTuneEvaluations() const { return tuneEvaluations; }
+        size_t getTuneScenarios() const { return tuneScenarios; }
+        // the tuner runs whole simulations side by side, each one on a single thread
+        void runSerially() { workerThreads = 1; shardsN = 1; }
+        const WorkloadSettings& getWorkload() const { return workload; }
+        std::mt19937& getRng() { return rng; }
+
+        std::vector<PackageHandle>& getPackages() { return packages; }
+        PackageStore& getPackageStore() { return packageStore; }
+
+        const CellGrid& getMap(){ return map; }
+        size_t getMapVersion() const { return mapVersion; }
+        const ChargingGraph& getChargingGraph() const { return chargingGraph; }
+        FlowFields& getFlowFields() { return flowFields; }
+        const Landmarks& getLandmarks() const { return landmarks; }
+        bool getOptimizeRoutes() const { return optimizeRoutes; }
+        size_t getPlanningBudget() const { return planningBudget; }
+        double getPlanningEpsilon() const { return planningEpsilon; }
+        const BitGrid& getPassable(TerrainType terrain) const { return terrain == TerrainType::AIR ? airCells : groundCells; }
+        const BitGrid& getChargerCells() const { return chargerCells; }
+        ReservationTable& getReservations() { return reservations; }
         const std::vector<std::pair<size_t,size_t>>& getClients(){ return clients; }
         const std::pair<size_t,size_t> getBaseCoords(){ return {baseRow, baseCol}; }
         std::vector<std::unique_ptr<Agent>>& getAgents() { return agents; }
 
         
-        void setMap(std::vector<std::vector<Cell>> _map);
+        void setMap(CellGrid _map);
+        // a loaded map decides its own size
+        void setMapSize(size_t rows, size_t cols) { rowsN = rows; columnsN = cols; }
         void setClients(std::vector<std::pair<size_t,size_t>> _clients);
         void setBaseCoords(std::pair<size_t,size_t> _baseCoords);
         void setAgents(std::vector<std::unique_ptr<Agent>> _agents);
 
         std::pair<size_t,size_t> getRandomClient();
 
-        void createRandomPackage(size_t tick);
+        void createPackage(size_t tick, std::pair<size_t,size_t> client, int reward, size_t deadline);
 
         void assignNextPackage(Agent& agent);
 
-        void decidePackageAssignment();
+        // cost of everything the agent already carries plus the trip back to base, cached on the agent
+        const RouteEstimate& committedRoute(Agent& agent);
+
+        // gives the front package to the cheapest agent, returns its index or agents.size() if none could take it
+        size_t decidePackageAssignment();
 
         void printSimulationParameters();
 
+        // Between the ticks: once a chunked map is over its MAP budget, the chunks no agent stands on or walks
+        // through are dropped, to be read from the map file again when a search reaches them
+        void pageMap();
+
+        // Legs are pure functions of the map, so the assignment stage memoises them and a worker can measure
+        // the ones the next stage is likely to need ahead of time (primeLegs). measureLeg touches no shared
+        // state and can run on any thread; legDistance, primeLegs and clearLegs belong to the main thread.
+        std::pair<int,int> measureLeg(TerrainType terrain, std::pair<size_t,size_t> from, std::pair<size_t,size_t> to) const;
+        std::pair<int,int> legDistance(TerrainType terrain, std::pair<size_t,size_t> from, std::pair<size_t,size_t> to);
+        size_t legKey(TerrainType terrain, std::pair<size_t,size_t> from, std::pair<size_t,size_t> to) const;
+        void primeLegs(const std::vector<Leg>& measured);
+        void clearLegs() { legs.clear(); }
+
 
 };
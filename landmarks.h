@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
+
+#include "types.h"
+#include "grid.h"
+#include "bitgrid.h"
+#include "memory.h"
+
+// ALT lower bounds for ground searches. Every landmark L keeps, per cost regime, the cheapest walk from L to
+// each cell and from each cell to L over the step costs aStar uses; by the triangle inequality a walk from a
+// to b costs at least to(b) - to(a) and at least from(a) - from(b). On a wall-dense map that is far closer to
+// the real cost than the Manhattan distance. Landmarks are picked farthest first: the cell farthest from the
+// base, then each time the cell farthest from every landmark so far, which spreads them over the rim of the
+// reachable area where the bounds are tightest. LANDMARKS: n sets how many (0 turns them off); a landmark
+// costs 4 ints per cell and those that would go over the CACHES budget are dropped. Air needs none.
+class Landmarks{
+    size_t rows = 0, cols = 0, count = 0;
+    std::vector<std::pair<size_t,size_t>> chosen;
+    // (cell * 2 + low battery) * 2 * count: count walks from the landmarks, then count walks to them; -1 unreachable
+    std::vector<int> table;
+    MemoryCharge memory{MemorySubsystem::CACHES};
+
+    public:
+        // the costs come from the current Policy, so set it first
+        void build(const CellGrid& map, const BitGrid& ground, std::pair<size_t,size_t> base, size_t wanted);
+
+        size_t getCount() const { return count; }
+        const std::vector<std::pair<size_t,size_t>>& getLandmarks() const { return chosen; }
+
+        // the landmark costs of a cell in one regime, 2 * count of them
+        const int* costs(std::pair<size_t,size_t> cell, bool lowBattery) const {
+            return table.data() + ((cell.first * cols + cell.second) * 2 + lowBattery) * 2 * count;
+        }
+        // lower bound on the cost of a ground walk from the cell with costs a to the cell with costs b
+        int bound(const int* a, const int* b) const {
+            int best = 0;
+            for(size_t k = 0; k < count; k++){
+                if(a[k] >= 0 && b[k] >= 0)
+                    best = std::max(best, b[k] - a[k]);
+                if(a[count + k] >= 0 && b[count + k] >= 0)
+                    best = std::max(best, a[count + k] - b[count + k]);
+            }
+            return best;
+        }
+        // true when a landmark reaches one cell and not the other, so no ground walk joins them
+        bool separated(std::pair<size_t,size_t> a, std::pair<size_t,size_t> b) const;
+};
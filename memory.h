@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum class MemorySubsystem{
+    MAP,            // the cell grid and its bit masks
+    AGENTS,         // agent objects, names and package slots
+    ROUTES,         // the paths agents are walking
+    PACKAGES,       // the package store slabs
+    PATHFINDING,    // search scratch buffers
+    CACHES,         // charging graph fields and legs, reservation table
+    LOGS,           // tick logs buffered by worker threads and shards
+    COUNT
+};
+
+// Bytes held per subsystem, current and peak, counted by what the containers reserve. Every figure is kept by
+// whoever owns the memory (usually through a MemoryCharge), so reading the ledger never walks the simulation.
+// MEMORY_BUDGET: <subsystem> <KiB> caps a subsystem: caches and scratch buffers check fits() before growing and
+// shrink or skip what does not fit, the rest is only reported.
+class MemoryLedger{
+    static std::atomic<int64_t> current[static_cast<int>(MemorySubsystem::COUNT)];
+    static std::atomic<int64_t> peak[static_cast<int>(MemorySubsystem::COUNT)];
+    static size_t budget[static_cast<int>(MemorySubsystem::COUNT)];
+
+    public:
+        // negative bytes release
+        static void add(MemorySubsystem subsystem, int64_t bytes);
+        // true when `extra` more bytes stay inside the budget, always true without one
+        static bool fits(MemorySubsystem subsystem, size_t extra);
+
+        static void setBudget(MemorySubsystem subsystem, size_t bytes);
+        static size_t getBudget(MemorySubsystem subsystem) { return budget[static_cast<int>(subsystem)]; }
+        static size_t getCurrent(MemorySubsystem subsystem);
+        static size_t getPeak(MemorySubsystem subsystem);
+
+        static const char* name(MemorySubsystem subsystem);
+        // subsystem from its name (case insensitive), false if there is none
+        static bool parse(const std::string& text, MemorySubsystem& subsystem);
+};
+
+// Bytes charged to a subsystem for as long as the owner lives
+class MemoryCharge{
+    MemorySubsystem subsystem;
+    size_t bytes = 0;
+
+    public:
+        MemoryCharge(MemorySubsystem _subsystem, size_t _bytes = 0);
+        ~MemoryCharge();
+
+        MemoryCharge(const MemoryCharge&) = delete;
+        MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+        void resize(size_t _bytes);
+        size_t getBytes() const { return bytes; }
+};
+
+template<typename T>
+size_t bytesOf(const std::vector<T>& values){
+    return values.capacity() * sizeof(T);
+}
@@ -5,8 +5,44 @@
 
 #include "types.h"
 #include "agents/agents.h"
+#include "reservationtable.h"
+#include "bitgrid.h"
+#include "charginggraph.h"
+#include "policy.h"
+#include "landmarks.h"
+#include "planner.h"
 typedef std::pair<size_t,size_t> Pair;
 
-std::vector<Pair> aStar(const std::vector<std::vector<Cell>>& map, Pair start, Pair end, Agent& agent);
+// the cost regime of a search: at or below LOW_BATTERY_PERCENT of the battery chargers become cheap to step on
+inline bool lowBattery(size_t currentBattery, size_t maxBattery) {
+    return Policy::get().lowBattery(currentBattery, maxBattery);
+}
 
-std::pair<int,int> bfsDistance(const std::vector<std::vector<Cell>>& map, Pair start, Pair end, Agent& agent);
\ No newline at end of file
+// cost of stepping onto a cell
+inline int stepCost(Cell cell, bool lowBattery) {
+    const Policy& policy = Policy::get();
+    if (cell == Cell::STATION || cell == Cell::BASE)
+        return lowBattery ? policy.stationLowCost : policy.stationHighCost;
+    if (cell == Cell::CLIENT)
+        return policy.clientCost;
+    return policy.roadCost;
+}
+
+// with landmarks, ground searches are guided by their lower bounds instead of the Manhattan distance alone
+std::vector<Pair> aStar(const CellGrid& map, Pair start, Pair end, Agent& agent, const Landmarks* landmarks = nullptr);
+
+// space-time A* for ground agents, steers around cells other agents reserved inside the table's window
+std::vector<Pair> aStar(const CellGrid& map, Pair start, Pair end, Agent& agent, const ReservationTable& reservations, const Landmarks* landmarks = nullptr);
+
+// Weighted A* over the ground in slices, see AnytimeSearch. startSearch expands nothing; continueSearch expands
+// up to budget cells, taking them off it, and says whether search.path is ready, unreachable or still pending.
+void startSearch(AnytimeSearch& search, const CellGrid& map, Pair start, Pair goal, double epsilon, bool lowBattery, const Landmarks* landmarks = nullptr);
+SearchStatus continueSearch(AnytimeSearch& search, const CellGrid& map, const Landmarks* landmarks, size_t& budget);
+
+// {steps, chargers within that many steps of start} or {-1,0} when end cannot be reached
+std::pair<int,int> bfsDistance(const BitGrid& passable, const BitGrid& chargers, Pair start, Pair end);
+// same answer from a bidirectional flood, the hint comes from the charging graph's fields
+std::pair<int,int> bfsDistance(const BitGrid& passable, const ChargingGraph& graph, TerrainType terrain, Pair start, Pair end);
+// steps only, bidirectional, -1 when end cannot be reached
+int bfsDistance(const BitGrid& passable, Pair start, Pair end);
+std::pair<int,int> bfsDistance(const CellGrid& map, Pair start, Pair end, Agent& agent);
\ No newline at end of file
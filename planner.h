@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "types.h"
+
+enum class SearchStatus{
+    RUNNING,        // out of budget, continue on a later tick
+    FOUND,
+    UNREACHABLE
+};
+
+// A weighted A* over the ground that can stop after any expansion and go on later: f = g + epsilon * h, so the
+// path it finds costs at most epsilon times the cheapest one. Everything it needs between two calls is here
+// (cells are indices of the map's GridIndex), the cost regime is fixed when it starts.
+struct AnytimeSearch{
+    struct Open{
+        int f;
+        size_t cell;
+    };
+
+    std::pair<size_t,size_t> start, goal;
+    double epsilon = 1;
+    bool lowBattery = false;
+    std::vector<Open> open;                                     // a heap, cheapest f on top
+    std::unordered_map<size_t, std::pair<int,size_t>> reached;  // cell -> {g, parent}
+    std::unordered_set<size_t> closed;
+    std::vector<std::pair<size_t,size_t>> path;                 // once FOUND, without the start
+
+    void clear(){
+        open.clear();
+        reached.clear();
+        closed.clear();
+    }
+    size_t getBytes() const {
+        return open.capacity() * sizeof(Open) + reached.size() * (sizeof(size_t) + sizeof(std::pair<int,size_t>) + 2 * sizeof(void*))
+             + closed.size() * (sizeof(size_t) + 2 * sizeof(void*)) + path.capacity() * sizeof(std::pair<size_t,size_t>);
+    }
+};
+
+// Budgeted planning of one agent, PLANNING_BUDGET: n. Every tick the fleet may expand n cells, shared out between
+// the agents before they move (see Simulation::sharePlanningBudget). A route is first searched with PLANNING_EPSILON, paused and resumed on the next ticks if the budget runs out (the agent waits
+// meanwhile), then improved while the agent walks it: a search with a tighter epsilon from a cell some ticks
+// ahead on the path, spliced in if it is cheaper and the agent has not passed that cell yet, until epsilon is 1.
+struct PlanState{
+    size_t budget = 0;              // expansions left of this agent's share of the tick
+    bool searching = false;         // search is paused
+    bool refining = false;          // the search improves currentPath from its cell anchorFromEnd from the end
+    AnytimeSearch search;
+    size_t anchorFromEnd = 0;
+    // weight and goal of the planned path the agent follows, 1 when there is nothing left to improve
+    double pathEpsilon = 1;
+    std::pair<size_t,size_t> pathGoal;
+    // the last finished search, a route through a charger asks for the first leg again on the next tick; only
+    // reused under the cost regime it was searched with
+    bool finished = false;
+    std::pair<size_t,size_t> finishedStart, finishedGoal;
+    double finishedEpsilon = 1;
+    bool finishedLowBattery = false;
+    std::vector<std::pair<size_t,size_t>> finishedPath;
+
+    size_t paused = 0, refined = 0;
+
+    bool busy() const { return searching || pathEpsilon > 1; }
+    size_t getBytes() const { return search.getBytes() + finishedPath.capacity() * sizeof(std::pair<size_t,size_t>); }
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <istream>
+#include <cstdio>
+#include <cstddef>
+
+// The weights and thresholds packages are assigned and routes are searched with. Read from the simulation
+// settings or found by the tuner (see tuner.h) and reached everywhere through Policy::get(), so it has to be
+// set before the first worker thread or shard process starts.
+struct Policy{
+    int distWeight = 10;            // assignment cost of a tick on the road
+    int stationWeight = 5;          // assignment bonus for every charger along the way
+    int roadCost = 10;              // search cost of stepping onto a road cell
+    int clientCost = 6;             // ... onto a client
+    int stationHighCost = 30;       // ... onto a charger while the battery is fine
+    int stationLowCost = 2;         // ... onto a charger once it runs low
+    int lowBatteryPercent = 25;     // at or below it a search takes the low battery costs
+    int rechargePercent = 25;       // below it an agent checks it can still reach a charger
+
+    bool lowBattery(size_t currentBattery, size_t maxBattery) const {
+        return currentBattery * 100 <= static_cast<size_t>(lowBatteryPercent) * maxBattery;
+    }
+    bool rechargeDue(size_t currentBattery, size_t maxBattery) const {
+        return currentBattery * 100 < static_cast<size_t>(rechargePercent) * maxBattery;
+    }
+
+    // reads the value of a policy setting, false when the label is not one
+    bool read(const std::string& label, std::istream& value);
+    // one setting per line, the way simulation_setup.txt takes them
+    void write(std::FILE* file) const;
+    // every setting at its built in value
+    bool isDefault() const;
+
+    static const Policy& get() { return current; }
+    static void set(const Policy& policy) { current = policy; }
+
+    // every setting with the range the tuner searches
+    struct Field{
+        const char* label;
+        int Policy::* value;
+        int low, high;
+    };
+    static const std::vector<Field>& fields();
+
+    private:
+        static Policy current;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "memory.h"
+
+// Space-time reservations for cooperative ground routing: which agent holds a cell on a given tick.
+// Only the next `window` ticks are kept, one open addressing bucket per tick in a ring, so a bucket is
+// reused (and its old tick forgotten) as soon as the simulation moves past it.
+class ReservationTable{
+    struct Bucket{
+        size_t tick = SIZE_MAX;
+        size_t used = 0;
+        std::vector<uint64_t> slots;    // (cell << 32) | agentId
+    };
+
+    size_t window = 16;
+    size_t now = 0;
+    size_t cols = 0;
+    std::vector<Bucket> buckets;
+    std::unordered_map<size_t, std::vector<std::pair<size_t,uint32_t>>> owned;   // agent -> (tick, cell)
+    MemoryCharge memory{MemorySubsystem::CACHES};                               // bucket slots
+
+    const Bucket* liveBucket(size_t tick) const;
+    Bucket& writableBucket(size_t tick);
+
+    public:
+        void configure(size_t _window, size_t _cols);
+        void advance(size_t tick);
+
+        size_t getWindow() const { return window; }
+        size_t getNow() const { return now; }
+
+        // a cell is free when nobody but the asking agent holds it, ticks outside the window are always free
+        bool isFree(std::pair<size_t,size_t> cell, size_t tick, size_t agentId) const;
+        void reserve(size_t agentId, std::pair<size_t,size_t> cell, size_t tick);
+        void release(size_t agentId);
+};
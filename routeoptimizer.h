@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+
+#include "agents/packagestore.h"
+
+class HiveMind;
+class Agent;
+
+// Delivery order for the packages an agent carries, leaving from origin on startTick and ending back at base.
+// An order is scored by what it costs in profit: the agent's cost for every tick on the road plus deliveredLate
+// for every package past its deadline. Built by cheapest insertion in deadline order, then improved with 2-opt;
+// the order the packages came in is kept unless something is strictly cheaper. Legs between the base, the
+// stations and the clients are charging graph lookups, only a leg from anywhere else needs a flood.
+// Returns true when the order changed.
+bool optimizeDeliveryOrder(HiveMind& hiveMind, const Agent& agent, std::pair<size_t,size_t> origin, size_t startTick,
+                           std::vector<PackageHandle>& stops);
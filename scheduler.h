@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+#include "grid.h"
+
+class Agent;
+class HiveMind;
+
+enum class EventType{
+    CHARGE_COMPLETE,
+    ARRIVAL,        // reaches a charger, the end of a leg or the low battery mark
+    DELIVERY,       // reaches the client of the package it carries first
+    STEP            // nothing predictable, tick it again next tick
+};
+
+struct SimEvent{
+    size_t tick;
+    EventType type;
+    size_t agent;
+
+    bool operator>(const SimEvent& other) const { return tick > other.tick; }
+};
+
+// Active/sleeping sets of the fleet. An agent is active on the ticks it has to be ticked on; in between it
+// sleeps through ticks that are fully predictable (charging, walking a straight stretch of its path) or
+// until a package is assigned to it (idle at base). Sleeping agents are brought up to date lazily with
+// Agent::skipTicks, only when something reads their state.
+class Scheduler{
+    std::vector<std::unique_ptr<Agent>>& agents;
+
+    // wakeTick: next tick the agent has to be ticked on, synced: last tick its state accounts for
+    std::vector<size_t> wakeTick, synced;
+    // one entry per sleep, entries whose tick no longer matches wakeTick are stale and skipped
+    std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> events;
+
+    public:
+        static constexpr size_t NEVER = SIZE_MAX;
+
+        // every agent starts active on tick 1
+        Scheduler(std::vector<std::unique_ptr<Agent>>& _agents);
+
+        // the agent is ticked on `tick` whatever it was sleeping for
+        void wake(size_t agent, size_t tick);
+        // after ticking the agent on `tick`, puts it to sleep for as long as it is predictable
+        void sleep(size_t agent, size_t tick, const CellGrid& map, HiveMind& hiveMind);
+        // removes the agent for good
+        void retire(size_t agent);
+        void markSynced(size_t agent, size_t tick) { synced[agent] = tick; }
+
+        // applies the ticks the agent slept through, up to and including `tick`
+        void catchUp(size_t agent, size_t tick, int& profit);
+        void catchUpAll(size_t tick, int& profit);
+
+        // the agents to tick on `tick`, in fleet order
+        std::vector<size_t> due(size_t tick);
+        // the first tick after `tick` some agent wakes on, NEVER if all of them sleep for good
+        size_t nextWake(size_t tick);
+
+        size_t getWakeTick(size_t agent) const { return wakeTick[agent]; }
+};
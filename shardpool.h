@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "hivemind.h"
+
+struct TickOutput;
+
+// Shard processes for SHARDS: n. Each one is forked from the loaded simulation, so it starts with its own copy
+// of the map, the charging graph and the fleet, and stands for a node owning one region of the map. The parent
+// stays the coordinator: it keeps the authoritative agents, spawns and assigns packages, and every tick sends
+// the due agents of a region (their state and packages) to that region's shard over a local socket. The shard
+// ticks them and sends back their new state and the TickOutput of each. An agent that crosses into another
+// region is simply sent to the other shard on its next tick.
+// Shards split the ticking, not the memory: every child keeps the whole HiveMind, shared copy-on-write with the
+// parent until either side writes to it, so the pages the shards touch are copies and the total only grows.
+// Needs fork() and socketpair(), elsewhere the pool starts no shard and the caller ticks in process.
+class ShardPool{
+    struct Shard{
+        int socket = -1;
+        long pid = -1;
+    };
+
+    HiveMind& hiveMind;
+    std::vector<Shard> shards;
+
+    void serve(int socket);
+    void lose(size_t shard);
+
+    public:
+        ShardPool(HiveMind& _hiveMind, size_t shardsN);
+        ~ShardPool();
+
+        ShardPool(const ShardPool&) = delete;
+        ShardPool& operator=(const ShardPool&) = delete;
+
+        size_t getShards() const { return shards.size(); }
+
+        // groups[s] are positions into `due` owned by shard s; outputs[k] receives the side effects of due[k].
+        // Returns the positions no shard could tick (a shard went away), those agents are left untouched.
+        std::vector<size_t> tick(const std::vector<size_t>& due, const std::vector<std::vector<size_t>>& groups, size_t tick, std::vector<TickOutput>& outputs);
+};
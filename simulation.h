@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdio>
+
+#include "hivemind.h"
+#include "scheduler.h"
+#include "threadpool.h"
+#include "spatialpartition.h"
+#include "shardpool.h"
+#include "workload/IWorkload.h"
+#include "workload/OrderQueue.h"
+#include "snapshot.h"
+
+// Owns the tick loop and the counters of one run over a loaded HiveMind
+class Simulation{
+    HiveMind& hiveMind;
+
+    int profit = 0;
+    size_t deadAgents = 0;
+    size_t spawnedPackages = 0;
+    size_t delivered = 0;
+    size_t dropped = 0;
+
+    Workload workload;
+    // orders of the next arrival, drawn ahead by speculate()
+    bool prefetched = false;
+    size_t prefetchedTick = 0;
+    std::vector<Order> prefetchedOrders;
+
+    // live orders, drained on the main thread at the start of a tick; only allocated with ORDER_PIPE or the
+    // live workload
+    std::unique_ptr<OrderQueue> orders;
+    std::unique_ptr<OrderPipe> pipe;
+    size_t rejectedOrders = 0;
+    size_t lateTicks = 0;           // real-time ticks that ran past deltaTime
+
+    // the end of every tick, for readers outside the tick loop
+    SnapshotBuffer snapshots;
+    void publishSnapshot(Scheduler& scheduler, size_t tick);
+
+    // what the next assignment stage is expected to score, measured while the agents move
+    struct SpeculationInput{
+        bool prefetch = false;
+        std::vector<std::pair<TerrainType, std::pair<size_t,size_t>>> sources;
+        std::vector<std::pair<size_t,size_t>> targets;
+        std::vector<Leg> measured;
+    };
+
+    // with WORKER_THREADS above 1 the due agents are ticked per tile on the pool,
+    // with SHARDS above 1 every tile belongs to a shard process instead
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<ShardPool> shardPool;
+    SpatialPartition tiles;
+
+    // the workload seen through the prefetched arrival
+    size_t nextArrival() const;
+    std::vector<Order> takeOrders();
+    bool spawnDue(size_t tick) const;
+    // tick of the next arrival while packages are left to spawn
+    size_t nextSpawn() const;
+    void spawnPackages(size_t tick);
+    // with live orders the run waits for TOTAL_PACKAGES or the last tick
+    bool ingesting() const;
+    void ingestOrders(size_t tick);
+    // spawns and assigns this tick's packages, waking the agents that get one
+    void assignPackages(Scheduler& scheduler, size_t tick);
+    // ticks the agents due on this tick and puts them back to sleep
+    void tickActive(Scheduler& scheduler, size_t tick);
+    // PLANNING_BUDGET: hands every due agent its share of the tick's budget before any of them moves
+    void sharePlanningBudget(const std::vector<size_t>& due, size_t tick);
+    bool prepareSpeculation(const std::vector<size_t>& due, SpeculationInput& next);
+    void speculate(SpeculationInput& next);
+    void tickTiles(const std::vector<size_t>& due, size_t tick, SpeculationInput* next);
+    void tickShards(const std::vector<size_t>& due, size_t tick);
+    // applies what the agents ticked off the main thread left behind, in fleet order
+    void applyOutputs(std::vector<TickOutput>& outputs);
+    void writeMemoryReport(std::FILE* resultFile);
+
+    public:
+        Simulation(HiveMind& _hiveMind);
+
+        // the loop condition, checked before every tick
+        bool running() const;
+
+        // real time loop paced to deltaTime, every tick only the agents that are awake get ticked
+        void run();
+        // same results as run(), but jumps straight to the next tick where something changes
+        void runEventDriven();
+
+        void returnUnpickedPackages();
+        void writeResults(const char* fileName);
+        // profit once the packages left at the base are charged for, what writeResults reports
+        int finalProfit() const;
+
+        // producers in the same process push orders here, from any thread; nullptr unless ingesting
+        OrderQueue* getOrderQueue() { return orders.get(); }
+        // readers in the same process take snapshots here, one thread at a time; with STATUS_SOCKET that
+        // thread is the StatusServer's
+        SnapshotBuffer& getSnapshots() { return snapshots; }
+
+        int getProfit() const { return profit; }
+        size_t getDelivered() const { return delivered; }
+        size_t getDropped() const { return dropped; }
+        size_t getDeadAgents() const { return deadAgents; }
+};
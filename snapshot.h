@@ -0,0 +1,87 @@
+#pragma once
+
+#include "types.h"
+#include "memory.h"
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+// ========= SNAPSHOT =========
+// The run as it stood at the end of one tick, copied out of the tick loop for readers on other threads.
+// Sleeping agents and the costs they run up are settled when they wake (see Scheduler), so an asleep agent
+// shows the position and battery it went to sleep with.
+struct Snapshot{
+    struct AgentView{
+        size_t id;
+        char symbol;
+        AgentState state;
+        bool asleep;
+        std::pair<size_t,size_t> coordinates;
+        size_t battery, maxBattery;
+        size_t packages;
+    };
+
+    size_t tick = 0;
+    int profit = 0;
+    size_t delivered = 0, dropped = 0, deadAgents = 0, spawned = 0;
+    size_t queued = 0;              // packages waiting at the base
+    size_t oldestWait = 0;          // ticks the first of them has been waiting
+    std::vector<AgentView> agents;
+};
+
+// the text a StatusServer answers with: a line of counters, then a line per agent
+std::string formatSnapshot(const Snapshot& snapshot);
+
+// ========= SNAPSHOT BUFFER =========
+// Triple buffer between the tick loop, which writes a snapshot after every tick, and one reader thread. Each
+// side owns a slot and the third changes hands with a single atomic exchange, so neither side ever waits: the
+// writer always has a slot of its own to fill, the reader gets the newest complete one or keeps its own.
+class SnapshotBuffer{
+    static constexpr uint8_t FRESH = 4;     // on middle while the reader has not taken it yet
+
+    Snapshot slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;                       // the writer's slot
+    uint8_t front = 2;                      // the reader's slot
+    MemoryCharge memory{MemorySubsystem::CACHES};
+
+    public:
+        SnapshotBuffer() = default;
+        SnapshotBuffer(const SnapshotBuffer&) = delete;
+        SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+        // writer: fill the slot, then publish it
+        Snapshot& writable() { return slots[back]; }
+        void publish();
+
+        // reader, one thread at a time: the newest published snapshot, left alone by the writer until the
+        // next call
+        const Snapshot& latest();
+};
+
+// ========= STATUS SERVER =========
+// STATUS_SOCKET: path. Serves the latest snapshot on a Unix socket from its own thread, which is the
+// buffer's only reader: every connection gets one snapshot as text and is closed (nc -U path).
+class StatusServer{
+    SnapshotBuffer& snapshots;
+    std::string path;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> served{0};
+    std::thread server;
+
+    void serve();
+
+    public:
+        StatusServer(SnapshotBuffer& _snapshots, const std::string& _path);
+        ~StatusServer();
+
+        StatusServer(const StatusServer&) = delete;
+        StatusServer& operator=(const StatusServer&) = delete;
+
+        size_t getServed() const { return served.load(); }
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+class Agent;
+
+// Splits the map into bands of whole rows, one tile per worker. Every tick the agents due are bucketed by the
+// tile under them; an agent that walked across a cut simply lands in the neighbouring tile on the next tick.
+// The map is read only while agents tick, so tiles never need a copy of their neighbours' cells.
+// When the agents crowd into a few tiles the cuts move to the row quantiles of the current agents.
+class SpatialPartition{
+    size_t rows = 0;
+    std::vector<size_t> cuts;       // tile t owns rows [cuts[t], cuts[t + 1])
+    size_t retiles = 0;
+
+    void retile(const std::vector<size_t>& agentRows);
+
+    public:
+        void configure(size_t _rows, size_t tiles);
+
+        size_t getTiles() const { return cuts.empty() ? 0 : cuts.size() - 1; }
+        size_t getRetiles() const { return retiles; }
+        size_t tileOf(size_t row) const;
+
+        // positions into `due` grouped per tile, in increasing order within a tile
+        std::vector<std::vector<size_t>> split(const std::vector<size_t>& due, std::vector<std::unique_ptr<Agent>>& agents);
+};
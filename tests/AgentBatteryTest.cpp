@@ -0,0 +1,62 @@
+// Low battery checks of a single agent, built against the whole simulation (see tests/build_tests.bat):
+// a drone one step from its client, with too little battery to reach any charger, still has to deliver.
+#include "../hivemind.h"
+#include "../agents/agents.h"
+
+#include <memory>
+#include <vector>
+#include <cstdio>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what){
+    if(!condition){
+        std::printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// one row, the base at one end and the client at the other, no station in between
+static void deliversWithNoChargerInReach(){
+    const size_t cols = 20;
+    CellGrid map(1, cols, Cell::ROAD, GridLayout::ROW_MAJOR);
+    map[0][0] = Cell::BASE;
+    map[0][cols - 1] = Cell::CLIENT;
+    std::pair<size_t,size_t> client{0, cols - 1};
+
+    HiveMind hiveMind;
+    hiveMind.setBaseCoords({0, 0});
+    hiveMind.setClients({client});
+    hiveMind.setMap(map);
+
+    std::vector<std::unique_ptr<Agent>> agents;
+    agents.push_back(std::make_unique<Drone>());
+    hiveMind.setAgents(std::move(agents));
+    Agent& drone = *hiveMind.getAgents()[0];
+
+    // 20 battery covers the last step (10) but not the 18 steps back to the base (60)
+    hiveMind.createPackage(1, client, 300, 10);
+    hiveMind.assignNextPackage(drone);
+    hiveMind.getPackageStore()[drone.getPackages().front()].location = Package::Location::AGENT;
+    drone.setCoordinates({0, cols - 2});
+    drone.setCurrentBattery(20);
+    drone.setState(AgentState::MOVING);
+    drone.setCurrentPath({client});
+
+    int profit = 0;
+    size_t delivered = 0, deadAgents = 0, dropped = 0;
+    for(size_t tick = 2; tick < 5 && delivered == 0 && drone.getState() != AgentState::DEAD; tick++)
+        drone.tick(hiveMind.getMap(), hiveMind, profit, tick, delivered, deadAgents, dropped);
+
+    check(delivered == 1, "the drone delivers the package one step away");
+    check(drone.getCoordinates() == client, "the drone ends at the client, not on the way to the base");
+    check(drone.getState() != AgentState::DEAD && dropped == 0, "the drone does not die with the package");
+}
+
+int main(){
+    deliversWithNoChargerInReach();
+
+    if(failures == 0)
+        std::printf("Agent battery: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+// Stress test for the OrderQueue, built apart from the simulation (see tests/build_tests.bat):
+// several producers push numbered orders into a small ring while the consumer drains it, and every order has
+// to come out exactly once, in the order its producer pushed it.
+#include "../workload/OrderQueue.h"
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what){
+    if(!condition){
+        std::printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// producer p's i-th order: reward p, deadline i
+static void manyProducers(size_t producersN, size_t ordersN, size_t capacity){
+    OrderQueue queue(capacity);
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> producers;
+    for(size_t p = 0; p < producersN; p++)
+        producers.emplace_back([&queue, &stop, p, ordersN](){
+            for(size_t i = 0; i < ordersN; i++)
+                queue.pushOrWait({{p, i}, static_cast<int>(p), i}, stop);
+        });
+
+    std::vector<size_t> next(producersN, 0);
+    std::vector<Order> drained;
+    size_t received = 0;
+    bool ordered = true, known = true;
+    while(received < producersN * ordersN){
+        drained.clear();
+        received += queue.drain(drained, 64);
+        for(const Order& order : drained){
+            size_t p = static_cast<size_t>(order.reward);
+            if(p >= producersN || order.client.first != p || order.client.second != order.deadline){
+                known = false;
+                continue;
+            }
+            // a lost order shows as a gap, a duplicate as a step back
+            if(order.deadline != next[p])
+                ordered = false;
+            next[p] = order.deadline + 1;
+        }
+        if(drained.empty())
+            std::this_thread::yield();
+    }
+    for(std::thread& producer : producers)
+        producer.join();
+
+    check(known, "every order drained is one that was pushed");
+    check(ordered, "each producer's orders come out once, in its order");
+    bool all = true;
+    for(size_t p = 0; p < producersN; p++)
+        all = all && next[p] == ordersN;
+    check(all, "no producer's orders are missing");
+    check(queue.empty(), "the queue is empty once everything was drained");
+    check(queue.getAccepted() == producersN * ordersN, "accepted counts every order");
+    check(queue.getDropped() == 0, "pushOrWait never drops");
+}
+
+// a full ring refuses push at once and counts it
+static void fullQueue(){
+    OrderQueue queue(4);
+    size_t pushed = 0;
+    for(size_t i = 0; i < 10; i++)
+        pushed += queue.push({{0, i}, 0, i});
+    check(pushed == 4, "a ring of 4 takes 4 orders");
+    check(queue.getDropped() == 6, "the rest are dropped");
+
+    std::vector<Order> drained;
+    check(queue.drain(drained, 10) == 4, "the 4 come back out");
+    check(drained.size() == 4 && drained.front().deadline == 0 && drained.back().deadline == 3, "in the order they were pushed");
+    check(queue.push({{0, 4}, 0, 4}), "a drained ring takes orders again");
+}
+
+int main(){
+    fullQueue();
+    manyProducers(1, 20000, 8);
+    manyProducers(4, 20000, 8);
+    manyProducers(8, 20000, 1024);
+
+    if(failures){
+        std::printf("OrderQueue: %d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("OrderQueue: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,35 @@
+@echo off
+setlocal enabledelayedexpansion
+cd /d "%~dp0"
+
+REM Each test is its own program, built against the sources it exercises
+echo Compiling the OrderQueue test...
+g++ -std=c++17 -Wall OrderQueueTest.cpp ..\workload\OrderQueue.cpp -o OrderQueueTest.exe
+
+if %ERRORLEVEL% neq 0 (
+    echo Compilation failed!
+    pause
+    exit /b
+)
+
+REM The agent tests need the whole simulation, every source but the main program and the tests
+set "SOURCES="
+for /R .. %%f in (*.cpp) do (
+    set "FILE=%%f"
+    if "!FILE:\tests\=!"=="!FILE!" if /I not "%%~nxf"=="main.cpp" set "SOURCES=!SOURCES! %%f"
+)
+
+echo Compiling the agent battery test...
+g++ -std=c++17 -Wall AgentBatteryTest.cpp !SOURCES! -o AgentBatteryTest.exe
+
+if %ERRORLEVEL% neq 0 (
+    echo Compilation failed!
+    pause
+    exit /b
+)
+
+echo Running tests...
+OrderQueueTest.exe
+AgentBatteryTest.exe
+
+pause
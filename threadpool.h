@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+// Workers started once and kept for the whole run. parallelFor hands out the indices of one batch, the calling
+// thread works on it too, and returns once every worker has finished its share and gone back to waiting.
+class ThreadPool{
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeUp, finished;
+
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobsN = 0;
+    std::atomic<size_t> nextJob{0};
+    size_t generation = 0;
+    size_t finishedWorkers = 0;     // workers done with the current batch
+    bool stopping = false;
+
+    void work();
+    void workerLoop();
+
+    public:
+        // threads counts the calling thread, so ThreadPool(1) starts no worker and runs everything inline
+        ThreadPool(size_t threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t getThreads() const { return workers.size() + 1; }
+
+        void parallelFor(size_t n, const std::function<void(size_t)>& body);
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <cstddef>
+
+#include "hivemind.h"
+#include "policy.h"
+
+// TUNE: n searches the policy space for the most profitable configuration of the loaded scenario. Every policy
+// runs the whole simulation headless in a forked process, as many at once as there are cores (or
+// WORKER_THREADS), and is scored by its final profit averaged over TUNE_SCENARIOS maps and workloads drawn
+// from SEED, SEED + 1, ... The first third of the policies are drawn uniformly over Policy::fields(), the
+// rest are mutations of the best ones so far with a step that narrows as the budget runs out.
+// Needs fork(), elsewhere nothing is evaluated and the loaded policy is kept.
+class Tuner{
+    struct Trial{
+        Policy policy;
+        double profit;
+    };
+
+    HiveMind& hiveMind;
+    size_t evaluations, scenarios, workers;
+    std::mt19937 rng;
+    std::vector<Trial> trials;  // best first
+
+    Policy sample();
+    Policy mutate(const Policy& policy, double spread);
+    // mean final profit of each policy, empty when nothing could run
+    std::vector<double> evaluate(const std::vector<Policy>& batch);
+    // one simulation, in the child process
+    int simulate(const Policy& policy, size_t scenario);
+
+    public:
+        Tuner(HiveMind& _hiveMind);
+
+        // the best policy found, also left as the current one
+        const Policy& run();
+        void writeResults(const char* fileName);
+};
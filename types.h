@@ -1,6 +1,7 @@
 #pragma once
 
 #include <unordered_map>
+#include <cstdint>
 #include <string>
 
 
@@ -15,7 +16,7 @@ enum class AgentState{
     DEAD
 };
 
-enum class Cell{
+enum class Cell : uint8_t{
     ROAD,
     WALL,
     BASE,
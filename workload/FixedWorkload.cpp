@@ -0,0 +1,14 @@
+#include "IWorkload.h"
+
+FixedWorkload::FixedWorkload(HiveMind& _hiveMind):
+RandomOrders(_hiveMind),
+period(_hiveMind.getSpawnFreqN()),
+next(_hiveMind.getSpawnFreqN())
+{}
+
+std::vector<Order> FixedWorkload::take(){
+    std::vector<Order> orders;
+    addBurst(orders);
+    next += period;
+    return orders;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../hivemind.h"
+#include "../types.h"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+// One order of the stream, it becomes a Package on the tick it arrives
+struct Order{
+    std::pair<size_t,size_t> client;
+    int reward;
+    size_t deadline;
+};
+
+constexpr size_t NO_ARRIVAL = SIZE_MAX;
+
+// ========= STRATEGY INTERFACE =========
+// The next arrival is always known ahead of time, so the event driven engine can jump straight to it
+class IWorkload{
+
+    public:
+    // tick of the next arrival (at least 1), NO_ARRIVAL once the stream is over
+    virtual size_t nextArrival() const = 0;
+    // every order arriving on nextArrival(), then moves on to the arrival after it
+    virtual std::vector<Order> take() = 0;
+    virtual ~IWorkload() = default;
+};
+
+// ========= STRATEGY CONTEXT =========
+class Workload{
+    IWorkload *strategy;
+
+    public:
+    Workload();
+    Workload(IWorkload* _strategy);
+    ~Workload();
+    void setStrategy(IWorkload* strategy);
+    size_t nextArrival() const;
+    std::vector<Order> take();
+
+    // the strategy picked by the WORKLOAD settings of simulation_setup.txt
+    static IWorkload* fromSettings(HiveMind& hiveMind);
+};
+
+// ========= STRATEGIES =========
+
+// ========= RANDOM ORDERS =========
+// uniform reward (200-800) and deadline (10-20), clients uniform or Zipf skewed towards the first ones
+class RandomOrders{
+
+    protected:
+    HiveMind& hiveMind;
+    size_t burstSize;
+    std::discrete_distribution<size_t> hotClients;
+    bool skewed;
+
+    public:
+        RandomOrders(HiveMind& _hiveMind);
+        Order randomOrder();
+        // one arrival brings burstSize orders
+        void addBurst(std::vector<Order>& orders);
+};
+
+// ========= FIXED =========
+// one burst every SPAWN_FREQUENCY ticks
+class FixedWorkload: public IWorkload, protected RandomOrders{
+
+    private:
+    size_t period, next;
+
+    public:
+        FixedWorkload(HiveMind& _hiveMind);
+        size_t nextArrival() const { return next; }
+        std::vector<Order> take();
+};
+
+// ========= POISSON =========
+// arrivals of a Poisson process of ARRIVAL_RATE per tick; the arrival at time t lands on tick ceil(t),
+// so several can share a tick
+class PoissonWorkload: public IWorkload, protected RandomOrders{
+
+    private:
+    double rate, amplitude, period;
+    double time = 0;
+    size_t next = 0;
+    std::exponential_distribution<double> gap;
+    std::uniform_real_distribution<double> accept;
+
+    void advance();
+
+    protected:
+    // rate(t) = rate * (1 + amplitude * sin(2 pi t / period)), sampled by thinning the peak rate process
+    PoissonWorkload(HiveMind& _hiveMind, double _amplitude, double _period);
+
+    public:
+        PoissonWorkload(HiveMind& _hiveMind);
+        size_t nextArrival() const { return next; }
+        std::vector<Order> take();
+};
+
+// ========= DIURNAL =========
+// ARRIVAL_RATE swinging by DIURNAL_AMPLITUDE over DIURNAL_PERIOD ticks: quiet nights, peak hours
+class DiurnalWorkload: public PoissonWorkload{
+
+    public:
+        DiurnalWorkload(HiveMind& _hiveMind);
+};
+
+// ========= LIVE =========
+// nothing generated, every order comes in through the order queue (ORDER_PIPE or Simulation::getOrderQueue)
+class LiveWorkload: public IWorkload{
+
+    public:
+        size_t nextArrival() const { return NO_ARRIVAL; }
+        std::vector<Order> take() { return {}; }
+};
+
+// ========= TRACE REPLAY =========
+// TRACE_FILE lines: tick row column reward deadline, '#' starts a comment
+class TraceWorkload: public IWorkload{
+
+    private:
+    std::vector<std::pair<size_t,Order>> orders;    // sorted by tick
+    size_t at = 0;
+
+    public:
+        TraceWorkload(HiveMind& hiveMind, const std::string& fileName);
+        bool empty() const { return orders.empty(); }
+        size_t nextArrival() const { return at < orders.size() ? orders[at].first : NO_ARRIVAL; }
+        std::vector<Order> take();
+};
@@ -0,0 +1,173 @@
+#include "OrderQueue.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PIPE_SUPPORTED 1
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// ========= ORDER QUEUE =========
+OrderQueue::OrderQueue(size_t capacity){
+    size_t size = 2;
+    while(size < capacity)
+        size *= 2;
+    slots = std::vector<Slot>(size);
+    mask = size - 1;
+    // a slot is free for the producer of position p once its sequence reads p
+    for(size_t i = 0; i < size; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool OrderQueue::tryPush(const Order& order){
+    size_t position = tail.load(std::memory_order_relaxed);
+    while(true){
+        Slot& slot = slots[position & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if(sequence == position){
+            if(tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(sequence < position)
+            return false;   // the consumer has not read this slot's last order yet: full
+        else
+            position = tail.load(std::memory_order_relaxed);
+    }
+
+    Slot& slot = slots[position & mask];
+    slot.order = order;
+    slot.sequence.store(position + 1, std::memory_order_release);
+    accepted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool OrderQueue::push(const Order& order){
+    if(tryPush(order))
+        return true;
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool OrderQueue::pushOrWait(const Order& order, const std::atomic<bool>& stop){
+    bool waited = false;
+    while(!tryPush(order)){
+        if(!waited)
+            stalls.fetch_add(1, std::memory_order_relaxed);
+        waited = true;
+        if(stop.load())
+            return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+size_t OrderQueue::drain(std::vector<Order>& out, size_t limit){
+    size_t taken = 0;
+    while(taken < limit){
+        Slot& slot = slots[head & mask];
+        if(slot.sequence.load(std::memory_order_acquire) != head + 1)
+            break;
+        out.push_back(slot.order);
+        // free for the producer that laps the ring onto it
+        slot.sequence.store(head + mask + 1, std::memory_order_release);
+        head++;
+        taken++;
+    }
+    return taken;
+}
+
+bool OrderQueue::empty() const{
+    return slots[head & mask].sequence.load(std::memory_order_acquire) != head + 1;
+}
+
+// ========= ORDER PIPE =========
+static bool parseOrder(const std::string& line, Order& order){
+    std::istringstream iss(line.substr(0, line.find('#')));
+    return static_cast<bool>(iss >> order.client.first >> order.client.second >> order.reward >> order.deadline);
+}
+
+static bool blank(const std::string& line){
+    return line.substr(0, line.find('#')).find_first_not_of(" \t\r") == std::string::npos;
+}
+
+OrderPipe::OrderPipe(OrderQueue& _queue, const std::string& _path): queue(_queue), path(_path){
+    reader = std::thread(&OrderPipe::read, this);
+}
+
+OrderPipe::~OrderPipe(){
+    stopping = true;
+    reader.join();
+}
+
+#ifdef PIPE_SUPPORTED
+
+void OrderPipe::read(){
+    // non blocking, so opening a FIFO nobody writes to yet does not hold the thread
+    int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+    if(fd < 0){
+        std::cerr<<"Couln't open the order pipe " << path << "\n";
+        return;
+    }
+
+    std::string pending;
+    char buffer[1 << 16];
+    while(!stopping.load()){
+        pollfd watched = {fd, POLLIN, 0};
+        if(poll(&watched, 1, 50) <= 0)
+            continue;
+
+        ssize_t got = ::read(fd, buffer, sizeof(buffer));
+        if(got <= 0){
+            // end of file, or a FIFO between writers: wait for more
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        pending.append(buffer, got);
+
+        size_t start = 0;
+        for(size_t end = pending.find('\n'); end != std::string::npos; end = pending.find('\n', start)){
+            std::string line = pending.substr(start, end - start);
+            start = end + 1;
+            Order order;
+            if(parseOrder(line, order)){
+                if(!queue.pushOrWait(order, stopping))
+                    break;
+            }
+            else if(!blank(line))
+                malformed++;
+        }
+        pending.erase(0, start);
+    }
+    close(fd);
+}
+
+#else
+
+void OrderPipe::read(){
+    std::ifstream fin(path);
+    if(!fin.is_open()){
+        std::cerr<<"Couln't open the order pipe " << path << "\n";
+        return;
+    }
+
+    std::string line;
+    while(!stopping.load()){
+        if(!std::getline(fin, line)){
+            fin.clear();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        Order order;
+        if(parseOrder(line, order))
+            queue.pushOrWait(order, stopping);
+        else if(!blank(line))
+            malformed++;
+    }
+}
+
+#endif
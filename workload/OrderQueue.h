@@ -0,0 +1,73 @@
+#pragma once
+
+#include "IWorkload.h"
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <cstddef>
+
+// ========= ORDER QUEUE =========
+// Orders pushed from outside the simulation: any number of producer threads, one consumer, the tick loop.
+// A bounded ring where every slot carries a sequence number, so producers claim slots with a single CAS and
+// neither side ever takes a lock. A full queue refuses the order at once: push counts it as dropped,
+// pushOrWait keeps the producer waiting instead, which is how the backpressure reaches a pipe writer.
+class OrderQueue{
+    struct Slot{
+        std::atomic<size_t> sequence;
+        Order order;
+    };
+
+    std::vector<Slot> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> tail{0};      // next slot a producer claims
+    alignas(64) size_t head = 0;                  // next slot the consumer reads
+
+    std::atomic<size_t> accepted{0}, dropped{0}, stalls{0};
+
+    bool tryPush(const Order& order);
+
+    public:
+        // capacity is rounded up to a power of two
+        OrderQueue(size_t capacity);
+
+        OrderQueue(const OrderQueue&) = delete;
+        OrderQueue& operator=(const OrderQueue&) = delete;
+
+        // producers, any thread
+        bool push(const Order& order);
+        // waits for room while the queue is full, false only when stop is raised meanwhile
+        bool pushOrWait(const Order& order, const std::atomic<bool>& stop);
+
+        // consumer: moves up to limit orders into out, returns how many
+        size_t drain(std::vector<Order>& out, size_t limit);
+        bool empty() const;
+
+        size_t getAccepted() const { return accepted.load(); }
+        size_t getDropped() const { return dropped.load(); }
+        size_t getStalls() const { return stalls.load(); }
+};
+
+// ========= ORDER PIPE =========
+// Reads orders from a file or a named pipe on its own thread and pushes them into the queue, one per line:
+// row column reward deadline, '#' starts a comment. It keeps following the file like tail -f, so a FIFO can
+// be written by several processes over the whole run.
+class OrderPipe{
+    OrderQueue& queue;
+    std::string path;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> malformed{0};
+    std::thread reader;
+
+    void read();
+
+    public:
+        OrderPipe(OrderQueue& _queue, const std::string& _path);
+        ~OrderPipe();
+
+        OrderPipe(const OrderPipe&) = delete;
+        OrderPipe& operator=(const OrderPipe&) = delete;
+
+        size_t getMalformed() const { return malformed.load(); }
+};
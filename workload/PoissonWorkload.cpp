@@ -0,0 +1,50 @@
+#include "IWorkload.h"
+
+#include <cmath>
+
+static double arrivalRate(HiveMind& hiveMind){
+    double rate = hiveMind.getWorkload().arrivalRate;
+    return rate > 0 ? rate : 1.0 / hiveMind.getSpawnFreqN();
+}
+
+PoissonWorkload::PoissonWorkload(HiveMind& _hiveMind): PoissonWorkload(_hiveMind, 0, 1){}
+
+PoissonWorkload::PoissonWorkload(HiveMind& _hiveMind, double _amplitude, double _period):
+RandomOrders(_hiveMind),
+rate(arrivalRate(_hiveMind)),
+amplitude(std::min(std::max(_amplitude, 0.0), 1.0)),
+period(_period > 0 ? _period : 1),
+gap(rate * (1 + amplitude)),
+accept(0.0, 1.0)
+{
+    advance();
+}
+
+// next arrival of the peak rate process, kept with probability rate(t) / peak
+void PoissonWorkload::advance(){
+    const double pi = std::acos(-1.0);
+    std::mt19937& gen = hiveMind.getRng();
+    while(true){
+        time += gap(gen);
+        if(amplitude == 0)
+            break;
+        double rateNow = 1 + amplitude * std::sin(2 * pi * time / period);
+        if(accept(gen) * (1 + amplitude) < rateNow)
+            break;
+    }
+    next = std::max<size_t>(1, static_cast<size_t>(std::ceil(time)));
+}
+
+std::vector<Order> PoissonWorkload::take(){
+    std::vector<Order> orders;
+    size_t tick = next;
+    while(next == tick){
+        addBurst(orders);
+        advance();
+    }
+    return orders;
+}
+
+DiurnalWorkload::DiurnalWorkload(HiveMind& _hiveMind):
+PoissonWorkload(_hiveMind, _hiveMind.getWorkload().diurnalAmplitude, static_cast<double>(_hiveMind.getWorkload().diurnalPeriod))
+{}
@@ -0,0 +1,48 @@
+#include "IWorkload.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+TraceWorkload::TraceWorkload(HiveMind& hiveMind, const std::string& fileName){
+    std::ifstream fin(fileName);
+    if(!fin.is_open()){
+        std::cerr<<"Couln't open the file " << fileName << "\n";
+        return;
+    }
+
+    const CellGrid& map = hiveMind.getMap();
+    std::string line;
+    size_t lineNumber = 0;
+    while(std::getline(fin,line)){
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        size_t tick;
+        Order order;
+        if(!(iss >> tick >> order.client.first >> order.client.second >> order.reward >> order.deadline)){
+            if(line.find_first_not_of(" \t\r") != std::string::npos)
+                std::cerr<<"Skipping line " << lineNumber << " of " << fileName << ": expected tick row column reward deadline\n";
+            continue;
+        }
+        if(order.client.first >= map.size() || order.client.second >= map[0].size() || map[order.client.first][order.client.second] == Cell::WALL){
+            std::cerr<<"Skipping line " << lineNumber << " of " << fileName << ": no road at (" << order.client.first << "," << order.client.second << ")\n";
+            continue;
+        }
+        orders.push_back({std::max<size_t>(tick, 1), order});
+    }
+
+    // a trace merged from several sources may be out of order, same tick orders keep the file order
+    std::stable_sort(orders.begin(), orders.end(), [](const std::pair<size_t,Order>& a, const std::pair<size_t,Order>& b){
+        return a.first < b.first;
+    });
+}
+
+std::vector<Order> TraceWorkload::take(){
+    std::vector<Order> arrived;
+    size_t tick = nextArrival();
+    for(; at < orders.size() && orders[at].first == tick; at++)
+        arrived.push_back(orders[at].second);
+    return arrived;
+}
@@ -0,0 +1,76 @@
+#include "IWorkload.h"
+
+#include <iostream>
+#include <cmath>
+
+// CONSTRUCTORS
+Workload::Workload(): strategy(nullptr){}
+Workload::Workload(IWorkload* _strategy): strategy(_strategy){}
+
+// METHODS
+void Workload::setStrategy(IWorkload* _strategy){
+    if(strategy) delete strategy;
+    this->strategy = _strategy;
+}
+
+size_t Workload::nextArrival() const{
+    return this->strategy->nextArrival();
+}
+
+std::vector<Order> Workload::take(){
+    return this->strategy->take();
+}
+
+Workload::~Workload(){
+    if(strategy) delete strategy;
+}
+
+IWorkload* Workload::fromSettings(HiveMind& hiveMind){
+    const std::string& model = hiveMind.getWorkload().model;
+
+    if(model == "poisson")
+        return new PoissonWorkload(hiveMind);
+    if(model == "diurnal")
+        return new DiurnalWorkload(hiveMind);
+    if(model == "live")
+        return new LiveWorkload();
+    if(model == "trace"){
+        TraceWorkload* trace = new TraceWorkload(hiveMind, hiveMind.getWorkload().traceFile);
+        if(!trace->empty())
+            return trace;
+        delete trace;
+        std::cerr<<"No orders to replay, spawning every " << hiveMind.getSpawnFreqN() << " ticks instead\n";
+    }
+    else if(model != "fixed")
+        std::cerr<<"Unknown workload " << model << ", spawning every " << hiveMind.getSpawnFreqN() << " ticks instead\n";
+
+    return new FixedWorkload(hiveMind);
+}
+
+// ========= RANDOM ORDERS =========
+RandomOrders::RandomOrders(HiveMind& _hiveMind):
+hiveMind(_hiveMind),
+burstSize(std::max<size_t>(1, _hiveMind.getWorkload().burstSize)),
+skewed(_hiveMind.getWorkload().clientSkew > 0)
+{
+    if(skewed){
+        std::vector<double> weights;
+        for(size_t rank = 1; rank <= hiveMind.getClients().size(); rank++)
+            weights.push_back(1.0 / std::pow(static_cast<double>(rank), hiveMind.getWorkload().clientSkew));
+        hotClients = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+    }
+}
+
+Order RandomOrders::randomOrder(){
+    std::mt19937& gen = hiveMind.getRng();
+    Order order;
+    order.reward = std::uniform_int_distribution<int>(200, 800)(gen);
+    order.deadline = std::uniform_int_distribution<size_t>(10, 20)(gen);
+    order.client = skewed ? hiveMind.getClients()[hotClients(gen)] : hiveMind.getRandomClient();
+    return order;
+}
+
+void RandomOrders::addBurst(std::vector<Order>& orders){
+    for(size_t i = 0; i < burstSize; i++)
+        orders.push_back(randomOrder());
+}